@@ -20,17 +20,33 @@ echo Compiler found:
 g++ --version | findstr "g++"
 echo.
 
-REM Create bin directory if it doesn't exist
+REM Create output directories if they don't exist
 if not exist "bin" mkdir bin
+if not exist "build" mkdir build
+if not exist "lib" mkdir lib
+
+echo Building libvcsg...
+for %%f in (image_utils vcs rg dhcod resample scheduler pyramid audit vcsg) do (
+    g++ -std=c++11 -Wall -O2 -pthread -c -o build\%%f.o src\%%f.cpp
+    if errorlevel 1 goto :error
+)
+if exist lib\libvcsg.a del lib\libvcsg.a
+ar rcs lib\libvcsg.a build\image_utils.o build\vcs.o build\rg.o build\dhcod.o build\resample.o build\scheduler.o build\pyramid.o build\audit.o build\vcsg.o
+if %ERRORLEVEL% NEQ 0 goto :error
 
 echo Building main program...
-g++ -std=c++11 -Wall -O2 -o bin\vc_program.exe ^
-    src\main.cpp src\image_utils.cpp src\vcs.cpp src\rg.cpp src\dhcod.cpp
+g++ -std=c++11 -Wall -O2 -pthread -o bin\vc_program.exe ^
+    src\main.cpp src\daemon.cpp lib\libvcsg.a
 if %ERRORLEVEL% NEQ 0 goto :error
 
 echo Building analysis tool...
-g++ -std=c++11 -Wall -O2 -o bin\analyze.exe ^
-    src\analyze.cpp src\image_utils.cpp src\vcs.cpp src\rg.cpp src\dhcod.cpp
+g++ -std=c++11 -Wall -O2 -pthread -o bin\analyze.exe ^
+    src\analyze.cpp lib\libvcsg.a
+if %ERRORLEVEL% NEQ 0 goto :error
+
+echo Building benchmark...
+g++ -std=c++11 -Wall -O2 -pthread -o bin\bench.exe ^
+    src\bench.cpp lib\libvcsg.a
 if %ERRORLEVEL% NEQ 0 goto :error
 
 echo.
@@ -41,6 +57,8 @@ echo.
 echo Executables created in bin\ directory:
 echo   - vc_program.exe  (Main program)
 echo   - analyze.exe     (Analysis tool)
+echo   - bench.exe       (Scalability benchmark)
+echo Static library: lib\libvcsg.a  (C API in src\vcsg.h)
 echo.
 echo To run:
 echo   bin\vc_program.exe
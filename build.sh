@@ -17,16 +17,31 @@ echo "Compiler found:"
 g++ --version | head -n 1
 echo ""
 
-# Create bin directory
-mkdir -p bin
+# Create output directories
+mkdir -p bin build lib
+
+LIBS=$([ "$(uname -s)" = Linux ] && echo -lrt)
+
+echo "Building libvcsg..."
+for f in image_utils vcs rg dhcod resample scheduler pyramid audit vcsg; do
+    g++ -std=c++11 -Wall -O2 -pthread -fPIC -fvisibility=hidden -fvisibility-inlines-hidden -c -o build/$f.o src/$f.cpp || exit 1
+done
+rm -f lib/libvcsg.a
+ar rcs lib/libvcsg.a build/*.o || exit 1
+g++ -std=c++11 -O2 -pthread -shared -Wl,-soname,libvcsg.so.1 -Wl,--version-script,src/libvcsg.map -o lib/libvcsg.so.1 build/*.o $LIBS || exit 1
+ln -sf libvcsg.so.1 lib/libvcsg.so
 
 echo "Building main program..."
-g++ -std=c++11 -Wall -O2 -o bin/vc_program \
-    src/main.cpp src/image_utils.cpp src/vcs.cpp src/rg.cpp src/dhcod.cpp || exit 1
+g++ -std=c++11 -Wall -O2 -pthread -o bin/vc_program \
+    src/main.cpp src/daemon.cpp lib/libvcsg.a $LIBS || exit 1
 
 echo "Building analysis tool..."
-g++ -std=c++11 -Wall -O2 -o bin/analyze \
-    src/analyze.cpp src/image_utils.cpp src/vcs.cpp src/rg.cpp src/dhcod.cpp || exit 1
+g++ -std=c++11 -Wall -O2 -pthread -o bin/analyze \
+    src/analyze.cpp lib/libvcsg.a || exit 1
+
+echo "Building benchmark..."
+g++ -std=c++11 -Wall -O2 -pthread -o bin/bench \
+    src/bench.cpp lib/libvcsg.a || exit 1
 
 echo ""
 echo "==============================================="
@@ -36,6 +51,9 @@ echo ""
 echo "Executables created in bin/ directory:"
 echo "  - vc_program  (Main program)"
 echo "  - analyze     (Analysis tool)"
+echo "  - bench       (Scalability benchmark)"
+echo "Libraries created in lib/ directory:"
+echo "  - libvcsg.a, libvcsg.so  (C API in src/vcsg.h)"
 echo ""
 echo "To run:"
 echo "  bin/vc_program"
@@ -7,6 +7,10 @@
 #include "vcs.hpp"
 #include "rg.hpp"
 #include "dhcod.hpp"
+#include "scheduler.hpp"
+#include "audit.hpp"
+#include <cstdlib>
+#include <vector>
 
 // Calculate Mean Squared Error
 double calculateMSE(const Image &img1, const Image &img2)
@@ -17,18 +21,26 @@ double calculateMSE(const Image &img1, const Image &img2)
         return -1.0;
     }
 
-    double mse = 0.0;
-    int count = 0;
-
-    for (int r = 0; r < img1.height; ++r)
-    {
-        for (int c = 0; c < img1.width; ++c)
+    // Partial sums per tile, combined in tile order so the result does not
+    // depend on the thread count.
+    std::vector<double> partial(Scheduler::tileCount(img1.height), 0.0);
+    Scheduler::parallelRows(img1.height, [&](int r0, int r1)
+                            {
+        double sum = 0.0;
+        for (int r = r0; r < r1; ++r)
         {
-            double diff = img1.pixels[r][c] - img2.pixels[r][c];
-            mse += diff * diff;
-            count++;
+            for (int c = 0; c < img1.width; ++c)
+            {
+                double diff = img1.pixels[r][c] - img2.pixels[r][c];
+                sum += diff * diff;
+            }
         }
-    }
+        partial[r0 / Scheduler::kTileRows] = sum; });
+
+    double mse = 0.0;
+    for (size_t t = 0; t < partial.size(); ++t)
+        mse += partial[t];
+    long long count = (long long)img1.width * img1.height;
 
     return (count > 0) ? (mse / count) : 0.0;
 }
@@ -49,36 +61,53 @@ double calculatePSNR(const Image &original, const Image &decoded)
 // Calculate contrast ratio
 double calculateContrast(const Image &img, const Image &original)
 {
-    int blackPixels = 0, whitePixels = 0;
-    int blackIntensity = 0, whiteIntensity = 0;
-
-    for (int r = 0; r < img.height; ++r)
+    struct Counts
     {
-        for (int c = 0; c < img.width; ++c)
+        long long blackPixels, whitePixels, blackIntensity, whiteIntensity;
+    };
+    std::vector<Counts> partial(Scheduler::tileCount(img.height), Counts());
+
+    Scheduler::parallelRows(img.height, [&](int r0, int r1)
+                            {
+        Counts k = {0, 0, 0, 0};
+        for (int r = r0; r < r1; ++r)
         {
-            int orig_c = c;
-            int orig_r = r;
-
-            // Handle VCS expansion (2x width)
-            if (img.width == original.width * 2)
+            for (int c = 0; c < img.width; ++c)
             {
-                orig_c = c / 2;
-            }
+                int orig_c = c;
+                int orig_r = r;
 
-            if (orig_r < original.height && orig_c < original.width)
-            {
-                if (original.pixels[orig_r][orig_c] == 0)
-                { // Original white
-                    whiteIntensity += img.pixels[r][c];
-                    whitePixels++;
+                // Handle VCS expansion (2x width)
+                if (img.width == original.width * 2)
+                {
+                    orig_c = c / 2;
                 }
-                else
-                { // Original black
-                    blackIntensity += img.pixels[r][c];
-                    blackPixels++;
+
+                if (orig_r < original.height && orig_c < original.width)
+                {
+                    if (original.pixels[orig_r][orig_c] == 0)
+                    { // Original white
+                        k.whiteIntensity += img.pixels[r][c];
+                        k.whitePixels++;
+                    }
+                    else
+                    { // Original black
+                        k.blackIntensity += img.pixels[r][c];
+                        k.blackPixels++;
+                    }
                 }
             }
         }
+        partial[r0 / Scheduler::kTileRows] = k; });
+
+    long long blackPixels = 0, whitePixels = 0;
+    long long blackIntensity = 0, whiteIntensity = 0;
+    for (size_t t = 0; t < partial.size(); ++t)
+    {
+        blackPixels += partial[t].blackPixels;
+        whitePixels += partial[t].whitePixels;
+        blackIntensity += partial[t].blackIntensity;
+        whiteIntensity += partial[t].whiteIntensity;
     }
 
     double avgWhite = (whitePixels > 0) ? (double)whiteIntensity / whitePixels : 0;
@@ -102,21 +131,30 @@ long getFileSize(const std::string &filename)
 // Analyze share randomness (entropy)
 double calculateEntropy(const Image &img)
 {
-    int histogram[256] = {0};
-    int totalPixels = img.width * img.height;
-
-    // Build histogram
-    for (int r = 0; r < img.height; ++r)
-    {
-        for (int c = 0; c < img.width; ++c)
+    long long histogram[256] = {0};
+    long long totalPixels = (long long)img.width * img.height;
+
+    // Build histogram (one partial histogram per tile)
+    std::vector<std::vector<long long> > partial(Scheduler::tileCount(img.height));
+    Scheduler::parallelRows(img.height, [&](int r0, int r1)
+                            {
+        std::vector<long long> hist(256, 0);
+        for (int r = r0; r < r1; ++r)
         {
-            int val = img.pixels[r][c];
-            if (val >= 0 && val < 256)
+            for (int c = 0; c < img.width; ++c)
             {
-                histogram[val]++;
+                int val = img.pixels[r][c];
+                if (val >= 0 && val < 256)
+                {
+                    hist[val]++;
+                }
             }
         }
-    }
+        partial[r0 / Scheduler::kTileRows].swap(hist); });
+
+    for (size_t t = 0; t < partial.size(); ++t)
+        for (int i = 0; i < 256; ++i)
+            histogram[i] += partial[t][i];
 
     // Calculate entropy
     double entropy = 0.0;
@@ -132,6 +170,29 @@ double calculateEntropy(const Image &img)
     return entropy;
 }
 
+// Run the statistical audit on one saved share and print a table row.
+// Shares on disk are PGM (0=Black), so convert back to internal 1=Black first.
+bool printAuditRow(const std::string &name, const Image &loadedShare, const Image &secret, int expansion)
+{
+    Audit::Options opts;
+    opts.expansion = expansion;
+    Audit::Report rep = Audit::run(binarizeImage(loadedShare), &secret, opts);
+
+    std::cout << "   " << std::left << std::setw(14) << name << std::right
+              << std::setw(7) << rep.blackRatio
+              << std::setw(8) << rep.minBlockEntropy
+              << std::setw(9) << rep.runsZ
+              << std::setw(7) << rep.autocorrH << "/" << std::setw(5) << rep.autocorrV << "/" << std::setw(5) << rep.autocorrD
+              << std::setw(8) << rep.lagAutocorrZ
+              << std::setw(10) << rep.chiSquare
+              << std::setw(8) << rep.secretCorr
+              << std::setw(9) << rep.blockSecretZ
+              << "  " << (rep.passed() ? "PASS" : "FAIL") << std::endl;
+    for (size_t i = 0; i < rep.failures.size(); ++i)
+        std::cout << "        - " << rep.failures[i] << std::endl;
+    return rep.passed();
+}
+
 // Print comparison table
 void printComparison()
 {
@@ -269,11 +330,34 @@ void printComparison()
     std::cout << "   - Shares not perfectly random" << std::endl;
     std::cout << "   - XOR required for best results" << std::endl;
 
+    // Statistical audit of every share
+    std::cout << "\n8. SHARE SECURITY AUDIT" << std::endl;
+    std::cout << "   Random shares should look like fair coin flips: black ~0.50, block entropy ~1," << std::endl;
+    std::cout << "   runs |z| small, autocorrelations ~0, chi-square (2x2 patterns) small, no secret correlation" << std::endl;
+    std::cout << "   (overall, or in any 32x32 block: BlkSecZ = worst block's correlation as a z-score)." << std::endl;
+    std::cout << "   LagZ = largest autocorrelation z over row/column lags 2..32 and multiples of 32." << std::endl;
+    std::cout << "   (VCS: first subpixel of each pair; the second is its complement)" << std::endl;
+    std::cout << "   Share          Black  MinBlkH   Runs z  Autocorr h/v/d     LagZ      Chi2  SecCorr  BlkSecZ" << std::endl;
+    printAuditRow("VCS Share1", vcs_s1, original, 2);
+    printAuditRow("VCS Share2", vcs_s2, original, 2);
+    printAuditRow("RG Share1", rg_s1, original, 1);
+    printAuditRow("RG Share2", rg_s2, original, 1);
+    printAuditRow("DHCOD Share1", dh_s1, original, 1);
+    printAuditRow("DHCOD Share2", dh_s2, original, 1);
+    std::cout << "   (DHCOD shares are meaningful by design, so they are expected to fail)" << std::endl;
+
     std::cout << "\n========================================" << std::endl;
 }
 
-int main()
+int main(int argc, char *argv[])
 {
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc)
+            Scheduler::setThreadCount(std::atoi(argv[++i]));
+    }
+
     std::cout << "Visual Cryptography Comparison and Analysis Tool" << std::endl;
     std::cout << "=================================================" << std::endl;
 
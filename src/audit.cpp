@@ -0,0 +1,434 @@
+#include "audit.hpp"
+#include "scheduler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <stdint.h>
+
+namespace Audit {
+
+    namespace {
+
+        // Counters for one tile of rows. Merged in tile order afterwards.
+        struct Partial {
+            long long ones, n;
+            long long transitions, transPairs;
+            long long hSum, hPairs, vSum, vPairs, dSum, dPairs;
+            long long patterns[16];
+            long long sumX, sumS, sumXS, nS;    // over pixels that have a secret pixel
+
+            int firstBlockRow;                  // block rows this tile touched
+            std::vector<long long> blockOnes;   // (rows touched) x blocksX
+            std::vector<long long> blockCount;
+            std::vector<long long> blockX, blockS, blockXS, blockNS; // per-block secret sums
+
+            Partial() : ones(0), n(0), transitions(0), transPairs(0),
+                        hSum(0), hPairs(0), vSum(0), vPairs(0), dSum(0), dPairs(0),
+                        sumX(0), sumS(0), sumXS(0), nS(0), firstBlockRow(0) {
+                for (int i = 0; i < 16; ++i) patterns[i] = 0;
+            }
+        };
+
+        // Per-lag sums of the second pass: x * y, x and y over the pairs.
+        struct LagSums {
+            long long xy, x, y;
+            LagSums() : xy(0), x(0), y(0) {}
+        };
+
+        inline int popcount(uint64_t v) { return __builtin_popcountll(v); }
+
+        // Lags tested along an axis of n pixels: 2..blockSize for short-range
+        // structure, then the multiples of the tile height (the period of
+        // per-tile generators) and of the block size (where copied blocks
+        // line up), nearest first.
+        std::vector<int> lagSet(int n, int bs, int maxLags) {
+            std::vector<int> lags;
+            for (int l = 2; l <= bs && l < n; ++l) lags.push_back(l);
+            for (int l = Scheduler::kTileRows; l < n; l += Scheduler::kTileRows) lags.push_back(l);
+            for (int l = bs; l < n; l += bs) lags.push_back(l);
+            std::sort(lags.begin(), lags.end());
+            lags.erase(std::unique(lags.begin(), lags.end()), lags.end());
+            if ((int)lags.size() > maxLags) lags.resize(maxLags > 0 ? maxLags : 0);
+            return lags;
+        }
+
+        double binaryEntropy(double p) {
+            if (p <= 0.0 || p >= 1.0) return 0.0;
+            return -p * std::log2(p) - (1 - p) * std::log2(1 - p);
+        }
+
+        double autocorr(long long sum, long long pairs, double p) {
+            double var = p * (1 - p);
+            if (pairs == 0 || var == 0.0) return 0.0;
+            return ((double)sum / pairs - p * p) / var;
+        }
+
+        // A correlation over n samples of coin flips has a standard deviation
+        // of about 1/sqrt(n), so on small shares a fixed |r| limit fails valid
+        // shares. Limits never go below this many standard deviations.
+        const double kNoiseSigmas = 4.0;
+
+        double noiseFloor(double limit, long long n) {
+            double floor = (n > 0) ? kNoiseSigmas / std::sqrt((double)n) : limit;
+            return (floor > limit) ? floor : limit;
+        }
+
+        // Which pixel values count as black (1):  (v < threshold) != invert.
+        struct BitRule {
+            int threshold;
+            bool invert;
+            template <typename T> int operator()(T v) const { return ((v < threshold) != invert) ? 1 : 0; }
+        };
+        const BitRule kInternal = { 1, true };    // 0 = White, non-zero = Black
+        const BitRule kGray = { 128, false };     // PGM convention, 0 = Black
+
+        std::string describe(const char* what, double value, const char* op, double limit) {
+            std::ostringstream out;
+            out << what << " " << value << " " << op << " " << limit;
+            return out.str();
+        }
+
+        template <typename SharePixel, typename SecretPixel>
+        Report runRows(const std::vector<const SharePixel*>& share, int shareWidth, BitRule bit,
+                       const std::vector<const SecretPixel*>* secret, int secretWidth, BitRule secretBit,
+                       const Options& opts) {
+            const int e = (opts.expansion > 0) ? opts.expansion : 1;
+            const int bs = (opts.blockSize > 0) ? opts.blockSize : 32;
+            const int w = shareWidth / e; // tested (first) subpixel columns
+            const int h = (int)share.size();
+            const int sh = secret ? (int)secret->size() : 0;
+            const int nw = (w + 63) / 64; // packed words per row
+
+            Report rep;
+            rep.blocksX = (w + bs - 1) / bs;
+            rep.blocksY = (h + bs - 1) / bs;
+            rep.hasSecret = (secret != 0);
+
+            std::vector<Partial> partial(Scheduler::tileCount(h));
+            std::vector<uint64_t> packed((size_t)h * nw, 0); // bit c of row r = tested pixel (r, c)
+            std::vector<long long> rowOnes(h, 0);
+
+            Scheduler::parallelRows(h, [&](int r0, int r1) {
+                Partial& p = partial[r0 / Scheduler::kTileRows];
+                p.firstBlockRow = r0 / bs;
+                int blockRows = (r1 - 1) / bs - p.firstBlockRow + 1;
+                size_t cells = (size_t)blockRows * rep.blocksX;
+                p.blockOnes.assign(cells, 0);
+                p.blockCount.assign(cells, 0);
+                if (secret) {
+                    p.blockX.assign(cells, 0);
+                    p.blockS.assign(cells, 0);
+                    p.blockXS.assign(cells, 0);
+                    p.blockNS.assign(cells, 0);
+                }
+
+                for (int r = r0; r < r1; ++r) {
+                    const SharePixel* row = share[r];
+                    const SharePixel* next = (r + 1 < h) ? share[r + 1] : 0;
+                    const SecretPixel* srow = (r < sh) ? (*secret)[r] : 0;
+                    size_t bRow = (size_t)(r / bs - p.firstBlockRow) * rep.blocksX;
+                    long long* bOnes = &p.blockOnes[bRow];
+                    long long* bCount = &p.blockCount[bRow];
+                    uint64_t* bits = &packed[(size_t)r * nw];
+                    long long onesBefore = p.ones;
+
+                    for (int c = 0; c < w; ++c) {
+                        int x = bit(row[c * e]);
+                        bits[c >> 6] |= (uint64_t)x << (c & 63);
+                        p.ones += x;
+                        p.n++;
+                        bOnes[c / bs] += x;
+                        bCount[c / bs]++;
+
+                        if (c + 1 < w) {
+                            int right = bit(row[(c + 1) * e]);
+                            p.transitions += (x != right);
+                            p.transPairs++;
+                            p.hSum += x & right;
+                            p.hPairs++;
+                        }
+                        if (next) {
+                            p.vSum += x & bit(next[c * e]);
+                            p.vPairs++;
+                            if (c + 1 < w) {
+                                p.dSum += x & bit(next[(c + 1) * e]);
+                                p.dPairs++;
+                            }
+                        }
+                        // Non-overlapping 2x2 blocks (tiles start on even rows)
+                        if (next && (r % 2) == 0 && (c % 2) == 0 && c + 1 < w) {
+                            int pat = x | (bit(row[(c + 1) * e]) << 1) |
+                                      (bit(next[c * e]) << 2) | (bit(next[(c + 1) * e]) << 3);
+                            p.patterns[pat]++;
+                        }
+                        if (srow && c < secretWidth) {
+                            int s = secretBit(srow[c]);
+                            p.sumX += x;
+                            p.sumS += s;
+                            p.sumXS += x & s;
+                            p.nS++;
+                            size_t b = bRow + c / bs;
+                            p.blockX[b] += x;
+                            p.blockS[b] += s;
+                            p.blockXS[b] += x & s;
+                            p.blockNS[b]++;
+                        }
+                    }
+                    rowOnes[r] = p.ones - onesBefore;
+                }
+            });
+
+            // Longer lags, on the packed rows. The x and y sums of a lag come
+            // from rowOnes (vertical pairs (r, r + dy)) or the tile's column
+            // counts (horizontal pairs (c, c + dx)), so only x & y is counted
+            // per word; horizontal lags shift row r right by dx across words.
+            const std::vector<int> dyLags = lagSet(h, bs, opts.maxLags);
+            const std::vector<int> dxLags = lagSet(w, bs, opts.maxLags);
+            const size_t nLags = dyLags.size() + dxLags.size();
+            std::vector<std::vector<LagSums> > lagPartial(partial.size());
+            if (nLags > 0) {
+                Scheduler::parallelRows(h, [&](int r0, int r1) {
+                    std::vector<LagSums>& sums = lagPartial[r0 / Scheduler::kTileRows];
+                    sums.assign(nLags, LagSums());
+                    if (!dxLags.empty()) {
+                        std::vector<long long> colOnes(w + 1, 0); // prefix sums over this tile
+                        for (int r = r0; r < r1; ++r) {
+                            const uint64_t* a = &packed[(size_t)r * nw];
+                            for (int c = 0; c < w; ++c) colOnes[c + 1] += (a[c >> 6] >> (c & 63)) & 1;
+                        }
+                        for (int c = 0; c < w; ++c) colOnes[c + 1] += colOnes[c];
+                        for (size_t k = 0; k < dxLags.size(); ++k) {
+                            sums[dyLags.size() + k].x = colOnes[w - dxLags[k]];
+                            sums[dyLags.size() + k].y = colOnes[w] - colOnes[dxLags[k]];
+                        }
+                    }
+                    for (int r = r0; r < r1; ++r) {
+                        const uint64_t* a = &packed[(size_t)r * nw];
+                        for (size_t k = 0; k < dyLags.size() && r + dyLags[k] < h; ++k) {
+                            const uint64_t* b = a + (size_t)dyLags[k] * nw;
+                            long long xy = 0;
+                            for (int i = 0; i < nw; ++i) xy += popcount(a[i] & b[i]);
+                            sums[k].xy += xy;
+                            sums[k].x += rowOnes[r];
+                            sums[k].y += rowOnes[r + dyLags[k]];
+                        }
+                        for (size_t k = 0; k < dxLags.size(); ++k) {
+                            const int dx = dxLags[k], skip = dx >> 6, shift = dx & 63, limit = w - dx;
+                            long long xy = 0;
+                            for (int i = 0; i * 64 < limit; ++i) {
+                                // Columns past w are zero in packed, so y ends at w by itself
+                                uint64_t y = a[i + skip] >> shift;
+                                if (shift && i + skip + 1 < nw) y |= a[i + skip + 1] << (64 - shift);
+                                xy += popcount(a[i] & y);
+                            }
+                            sums[dyLags.size() + k].xy += xy;
+                        }
+                    }
+                });
+            }
+
+            // Merge
+            Partial t;
+            std::vector<long long> blockOnes((size_t)rep.blocksX * rep.blocksY, 0);
+            std::vector<long long> blockCount((size_t)rep.blocksX * rep.blocksY, 0);
+            std::vector<long long> blockX, blockS, blockXS, blockNS;
+            if (secret) {
+                blockX.assign(blockOnes.size(), 0);
+                blockS.assign(blockOnes.size(), 0);
+                blockXS.assign(blockOnes.size(), 0);
+                blockNS.assign(blockOnes.size(), 0);
+            }
+            for (size_t i = 0; i < partial.size(); ++i) {
+                const Partial& p = partial[i];
+                t.ones += p.ones; t.n += p.n;
+                t.transitions += p.transitions; t.transPairs += p.transPairs;
+                t.hSum += p.hSum; t.hPairs += p.hPairs;
+                t.vSum += p.vSum; t.vPairs += p.vPairs;
+                t.dSum += p.dSum; t.dPairs += p.dPairs;
+                for (int k = 0; k < 16; ++k) t.patterns[k] += p.patterns[k];
+                t.sumX += p.sumX; t.sumS += p.sumS; t.sumXS += p.sumXS; t.nS += p.nS;
+
+                size_t base = (size_t)p.firstBlockRow * rep.blocksX;
+                for (size_t k = 0; k < p.blockOnes.size(); ++k) {
+                    blockOnes[base + k] += p.blockOnes[k];
+                    blockCount[base + k] += p.blockCount[k];
+                }
+                for (size_t k = 0; k < p.blockNS.size(); ++k) {
+                    blockX[base + k] += p.blockX[k];
+                    blockS[base + k] += p.blockS[k];
+                    blockXS[base + k] += p.blockXS[k];
+                    blockNS[base + k] += p.blockNS[k];
+                }
+            }
+
+            if (t.n == 0) {
+                rep.blackRatio = 0;
+                rep.minBlockEntropy = rep.meanBlockEntropy = 0;
+                rep.runs = 0;
+                rep.runsZ = rep.autocorrH = rep.autocorrV = rep.autocorrD = rep.chiSquare = rep.secretCorr = 0;
+                rep.blockSecretCorr = rep.blockSecretZ = 0;
+                rep.lagAutocorr = rep.lagAutocorrZ = 0;
+                rep.lagDy = rep.lagDx = 0;
+                rep.failures.push_back("empty share");
+                return rep;
+            }
+
+            double p = (double)t.ones / t.n;
+            rep.blackRatio = p;
+
+            // Block entropy map. Border blocks with under a quarter of a full
+            // block's samples are mapped but not judged: a 1x1 corner block has
+            // entropy 0 whatever the share looks like.
+            const long long minSamples = (long long)bs * bs / 4;
+            rep.blockEntropy.assign(blockOnes.size(), 0.0);
+            rep.minBlockEntropy = 1.0;
+            double total = 0.0;
+            int judged = 0;
+            for (size_t k = 0; k < blockOnes.size(); ++k) {
+                double ent = blockCount[k] ? binaryEntropy((double)blockOnes[k] / blockCount[k]) : 0.0;
+                rep.blockEntropy[k] = ent;
+                if (blockCount[k] < minSamples) continue;
+                if (ent < rep.minBlockEntropy) rep.minBlockEntropy = ent;
+                total += ent;
+                judged++;
+            }
+            if (judged > 0) {
+                rep.meanBlockEntropy = total / judged;
+            } else {
+                // Share smaller than a quarter block: judge it as one block
+                rep.minBlockEntropy = rep.meanBlockEntropy = binaryEntropy(p);
+            }
+
+            // Runs test along rows: a run ends at every change of value.
+            // For coin flips with bias p, each neighbour pair differs with q = 2p(1-p).
+            rep.runs = t.transitions + h;
+            double q = 2.0 * p * (1.0 - p);
+            double sd = std::sqrt(t.transPairs * q * (1.0 - q));
+            rep.runsZ = (sd > 0) ? (t.transitions - t.transPairs * q) / sd : 0.0;
+
+            rep.autocorrH = autocorr(t.hSum, t.hPairs, p);
+            rep.autocorrV = autocorr(t.vSum, t.vPairs, p);
+            rep.autocorrD = autocorr(t.dSum, t.dPairs, p);
+
+            // Lagged autocorrelation, centred on p so its z is about N(0, 1)
+            // for coin flips: a share whose halves (or tiles, or blocks) repeat
+            // passes every lag-1 test but not this one.
+            rep.lagAutocorr = rep.lagAutocorrZ = 0.0;
+            rep.lagDy = rep.lagDx = 0;
+            for (size_t k = 0; k < nLags; ++k) {
+                LagSums s;
+                for (size_t i = 0; i < lagPartial.size(); ++i) {
+                    if (lagPartial[i].empty()) continue;
+                    s.xy += lagPartial[i][k].xy;
+                    s.x += lagPartial[i][k].x;
+                    s.y += lagPartial[i][k].y;
+                }
+                bool vertical = k < dyLags.size();
+                int lag = vertical ? dyLags[k] : dxLags[k - dyLags.size()];
+                long long pairs = vertical ? (long long)w * (h - lag) : (long long)(w - lag) * h;
+                double var = p * (1 - p);
+                if (pairs == 0 || var == 0.0) continue;
+                double r = ((s.xy - p * (s.x + s.y)) / pairs + p * p) / var;
+                double z = r * std::sqrt((double)pairs);
+                if (std::fabs(z) > std::fabs(rep.lagAutocorrZ)) {
+                    rep.lagAutocorr = r;
+                    rep.lagAutocorrZ = z;
+                    rep.lagDy = vertical ? lag : 0;
+                    rep.lagDx = vertical ? 0 : lag;
+                }
+            }
+
+            // 2x2 patterns should be uniform (1/16 each) for fair coins
+            long long blocks = 0;
+            for (int k = 0; k < 16; ++k) blocks += t.patterns[k];
+            rep.chiSquare = 0.0;
+            if (blocks > 0) {
+                double expected = blocks / 16.0;
+                for (int k = 0; k < 16; ++k) {
+                    double d = t.patterns[k] - expected;
+                    rep.chiSquare += d * d / expected;
+                }
+            }
+
+            // Share vs secret (Pearson, both binary)
+            rep.secretCorr = 0.0;
+            if (rep.hasSecret && t.nS > 0) {
+                double ex = (double)t.sumX / t.nS;
+                double es = (double)t.sumS / t.nS;
+                double exs = (double)t.sumXS / t.nS;
+                double var = ex * (1 - ex) * es * (1 - es);
+                if (var > 0) rep.secretCorr = (exs - ex * es) / std::sqrt(var);
+            }
+
+            // Per-block correlation: a global figure averages local leakage away
+            // (e.g. DHCOD share 2 copies the secret wherever the cover is flat).
+            // Judged as z = r * sqrt(n), so small blocks are not held to the
+            // same |r| as large ones.
+            rep.blockSecretCorr = rep.blockSecretZ = 0.0;
+            for (size_t k = 0; k < blockNS.size(); ++k) {
+                long long n = blockNS[k];
+                if (n < minSamples) continue;
+                double ex = (double)blockX[k] / n;
+                double es = (double)blockS[k] / n;
+                double exs = (double)blockXS[k] / n;
+                double var = ex * (1 - ex) * es * (1 - es);
+                if (var <= 0) continue; // constant share or secret in this block
+                double r = (exs - ex * es) / std::sqrt(var);
+                double z = r * std::sqrt((double)n);
+                if (std::fabs(z) > std::fabs(rep.blockSecretZ)) {
+                    rep.blockSecretZ = z;
+                    rep.blockSecretCorr = r;
+                }
+            }
+
+            // Verdict
+            if (rep.minBlockEntropy < opts.minBlockEntropy)
+                rep.failures.push_back(describe("min block entropy", rep.minBlockEntropy, "<", opts.minBlockEntropy));
+            if (std::fabs(rep.runsZ) > opts.maxRunsZ)
+                rep.failures.push_back(describe("runs test |z|", std::fabs(rep.runsZ), ">", opts.maxRunsZ));
+            double ac[3] = { rep.autocorrH, rep.autocorrV, rep.autocorrD };
+            const char* acName[3] = { "horizontal autocorrelation", "vertical autocorrelation", "diagonal autocorrelation" };
+            long long acPairs[3] = { t.hPairs, t.vPairs, t.dPairs };
+            for (int k = 0; k < 3; ++k) {
+                double limit = noiseFloor(opts.maxAutocorr, acPairs[k]);
+                if (std::fabs(ac[k]) > limit)
+                    rep.failures.push_back(describe(acName[k], ac[k], "beyond", limit));
+            }
+            if (std::fabs(rep.lagAutocorrZ) > opts.maxLagZ) {
+                std::ostringstream what;
+                what << "autocorrelation at lag (" << rep.lagDy << ", " << rep.lagDx << ") |z|";
+                rep.failures.push_back(describe(what.str().c_str(), std::fabs(rep.lagAutocorrZ), ">", opts.maxLagZ));
+            }
+            if (rep.chiSquare > opts.maxChiSquare)
+                rep.failures.push_back(describe("2x2 chi-square", rep.chiSquare, ">", opts.maxChiSquare));
+            double secretLimit = noiseFloor(opts.maxSecretCorr, t.nS);
+            if (rep.hasSecret && std::fabs(rep.secretCorr) > secretLimit)
+                rep.failures.push_back(describe("secret correlation", rep.secretCorr, "beyond", secretLimit));
+            if (rep.hasSecret && std::fabs(rep.blockSecretZ) > opts.maxBlockSecretZ)
+                rep.failures.push_back(describe("block secret correlation |z|", std::fabs(rep.blockSecretZ), ">",
+                                                opts.maxBlockSecretZ));
+
+            return rep;
+        }
+
+    }
+
+    Report run(const Image& share, const Image* secret, const Options& opts) {
+        std::vector<const int*> shareRows(share.height), secretRows;
+        for (int r = 0; r < share.height; ++r) shareRows[r] = share.pixels[r].data();
+        if (secret) {
+            secretRows.resize(secret->height);
+            for (int r = 0; r < secret->height; ++r) secretRows[r] = secret->pixels[r].data();
+        }
+        return runRows(shareRows, share.width, kInternal, secret ? &secretRows : 0,
+                       secret ? secret->width : 0, kInternal, opts);
+    }
+
+    Report run(const std::vector<const unsigned char*>& shareRows, int shareWidth, bool grayShare,
+               const std::vector<const unsigned char*>* secretRows, int secretWidth, bool graySecret,
+               const Options& opts) {
+        return runRows(shareRows, shareWidth, grayShare ? kGray : kInternal,
+                       secretRows, secretWidth, graySecret ? kGray : kInternal, opts);
+    }
+
+}
@@ -0,0 +1,86 @@
+#ifndef AUDIT_HPP
+#define AUDIT_HPP
+
+#include "image_utils.hpp"
+#include <string>
+#include <vector>
+
+namespace Audit {
+    // Statistical checks that a share looks like independent fair coin
+    // flips (and does not correlate with the secret).
+    // Input shares use the internal convention (1 = Black, 0 = White).
+    // Runs one pass over the share in parallel tiles; each tile keeps a few
+    // counters plus its rows of the block entropy map, and bit-packs its rows
+    // for a second pass over longer autocorrelation lags.
+
+    struct Options {
+        int blockSize;          // block entropy map granularity (pixels)
+        int expansion;          // subpixels per secret pixel (2 for VCS): only
+                                // the first subpixel of each group is tested,
+                                // the rest are determined by it
+        double minBlockEntropy; // fail below this (bits, max 1.0); border blocks with
+                                // under blockSize^2 / 4 samples are not judged
+        double maxRunsZ;        // fail if |z| of the runs test is above this
+        double maxAutocorr;     // fail if |autocorrelation| is above this (raised to
+                                // 4 / sqrt(pairs) on shares too small for it)
+        double maxChiSquare;    // 2x2 pattern test, 15 d.o.f. (37.7 = p 0.001)
+        double maxSecretCorr;   // fail if |share-vs-secret correlation| is above this
+                                // (same small-share floor)
+        double maxBlockSecretZ; // fail if any block's correlation with the secret,
+                                // as z = r * sqrt(samples), is above this in size
+                                // (6 leaves room for the max over many blocks)
+        double maxLagZ;         // fail if the autocorrelation at any lag below, as
+                                // z = r * sqrt(pairs), is above this in size
+        int maxLags;            // lags tested per direction: 2..blockSize, then the
+                                // multiples of Scheduler::kTileRows and blockSize.
+                                // Only row and column offsets are tested (no
+                                // diagonal combinations), and repeats at other
+                                // distances go unnoticed.
+
+        Options() : blockSize(32), expansion(1), minBlockEntropy(0.9), maxRunsZ(4.0),
+                    maxAutocorr(0.05), maxChiSquare(37.7), maxSecretCorr(0.05), maxBlockSecretZ(6.0),
+                    maxLagZ(6.0), maxLags(256) {}
+    };
+
+    struct Report {
+        double blackRatio;               // fraction of 1s
+
+        int blocksX, blocksY;
+        std::vector<double> blockEntropy; // blocksY x blocksX, row-major
+        double minBlockEntropy;
+        double meanBlockEntropy;
+
+        long long runs;                  // runs along rows
+        double runsZ;                    // vs. the count expected for coin flips
+
+        double autocorrH;                // lag (0, 1)
+        double autocorrV;                // lag (1, 0)
+        double autocorrD;                // lag (1, 1)
+
+        double lagAutocorr;              // over the longer lags (Options::maxLags),
+        double lagAutocorrZ;             // the one with the largest |z|
+        int lagDy, lagDx;                // and its offset
+
+        double chiSquare;                // 2x2 block patterns vs. coin flips
+
+        bool hasSecret;
+        double secretCorr;               // Pearson correlation with the secret
+        double blockSecretCorr;          // same, in the block with the largest |z|
+        double blockSecretZ;             // that block's r * sqrt(samples)
+
+        std::vector<std::string> failures; // empty = passed
+        bool passed() const { return failures.empty(); }
+    };
+
+    // secret may be null; otherwise it is binary (0/1) and the share is
+    // expansion times as wide.
+    Report run(const Image& share, const Image* secret = 0, const Options& opts = Options());
+
+    // Same, on rows of 8-bit buffers (the C API). gray* selects the PGM
+    // convention (below 128 = Black) instead of 0/1 with 1 = Black.
+    Report run(const std::vector<const unsigned char*>& shareRows, int shareWidth, bool grayShare,
+               const std::vector<const unsigned char*>* secretRows, int secretWidth, bool graySecret,
+               const Options& opts = Options());
+}
+
+#endif // AUDIT_HPP
@@ -0,0 +1,605 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <chrono>
+#include <iomanip>
+#include "image_utils.hpp"
+#include "vcs.hpp"
+#include "rg.hpp"
+#include "dhcod.hpp"
+#include "scheduler.hpp"
+#include "vcsg.h"
+#include <atomic>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+// Scalability and memory regression harness.
+// Secrets and covers are generated procedurally (nothing is stored on disk),
+// every scheme runs end-to-end and we record time, throughput and peak RSS.
+// The run fails if decryption is wrong or a baseline threshold regresses.
+// Each run happens in its own child process, so its peak RSS is its own.
+
+const int kMaxSide = 65536;
+
+// Largest side run through the Image pipeline (vector<vector<int>> images);
+// bigger runs are streamed through the C API a strip of rows at a time.
+const int kMaxImageSide = 8192;
+
+// ---------------------------------------------------------------------------
+// Procedural inputs: pixel(x, y) is a pure function, 0-255 grayscale.
+
+unsigned hash3(unsigned x, unsigned y, unsigned seed)
+{
+    unsigned h = x * 374761393u + y * 668265263u + seed * 2246822519u;
+    h = (h ^ (h >> 13)) * 1274126177u;
+    return h ^ (h >> 16);
+}
+
+int noisePixel(int x, int y, int, int)
+{
+    return hash3(x, y, 1) & 255;
+}
+
+int gradientPixel(int x, int y, int w, int h)
+{
+    long span = (long)w + h - 2;
+    return span > 0 ? (int)(((long)x + y) * 255 / span) : 0;
+}
+
+// Rows of pseudo-glyphs: 5x7 dots in 8x12 cells, dark ink on white paper.
+int textPixel(int x, int y, int, int)
+{
+    int cx = x / 8, cy = y / 12;
+    int gx = x % 8, gy = y % 12;
+    if (gx >= 5 || gy >= 7 || (cy % 4) == 3)
+        return 255; // letter spacing, line spacing, paragraph gap
+    unsigned glyph = hash3(cx, cy, 7) % 64;
+    if (glyph < 12)
+        return 255; // space
+    return (hash3(glyph, gx * 7 + gy, 11) & 3) ? 255 : 0;
+}
+
+// Smooth value noise over a lattice.
+double valueNoise(double x, double y, unsigned seed)
+{
+    int x0 = (int)std::floor(x), y0 = (int)std::floor(y);
+    double fx = x - x0, fy = y - y0;
+    fx = fx * fx * (3 - 2 * fx);
+    fy = fy * fy * (3 - 2 * fy);
+    double v00 = hash3(x0, y0, seed) & 255, v10 = hash3(x0 + 1, y0, seed) & 255;
+    double v01 = hash3(x0, y0 + 1, seed) & 255, v11 = hash3(x0 + 1, y0 + 1, seed) & 255;
+    double top = v00 + (v10 - v00) * fx;
+    double bottom = v01 + (v11 - v01) * fx;
+    return top + (bottom - top) * fy;
+}
+
+// Photo-like field: a few octaves of smooth noise, mostly low frequency.
+int photoPixel(int x, int y, int, int)
+{
+    double v = 0.55 * valueNoise(x / 97.0, y / 97.0, 3) + 0.3 * valueNoise(x / 23.0, y / 23.0, 5) + 0.15 * valueNoise(x / 5.0, y / 5.0, 9);
+    return (int)v;
+}
+
+struct Generator
+{
+    const char *name;
+    int (*pixel)(int x, int y, int w, int h);
+};
+
+const Generator kSecrets[] = {
+    {"noise", noisePixel},
+    {"text", textPixel},
+    {"gradient", gradientPixel},
+    {"photo", photoPixel},
+};
+
+Image render(const Generator &gen, int w, int h)
+{
+    Image img(w, h);
+    Scheduler::parallelRows(h, [&](int r0, int r1)
+                            {
+        for (int r = r0; r < r1; ++r)
+            for (int c = 0; c < w; ++c)
+                img.pixels[r][c] = gen.pixel(c, r, w, h); });
+    return img;
+}
+
+// ---------------------------------------------------------------------------
+// Measurements
+
+double peakRssMB()
+{
+#ifdef _WIN32
+    return 0.0; // not measured on Windows
+#else
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+#ifdef __APPLE__
+    return ru.ru_maxrss / (1024.0 * 1024.0); // bytes
+#else
+    return ru.ru_maxrss / 1024.0; // kilobytes
+#endif
+#endif
+}
+
+double secondsSince(std::chrono::steady_clock::time_point t0)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+// Digital reconstruction (s1 XOR s2) must equal 'expected' bit for bit, and
+// for stacked (OR) schemes every black secret pixel must come out black.
+// 'expansion' is the number of subpixels per secret pixel (2 for VCS).
+bool checkShares(const Image &expected, const Image &s1, const Image &s2, const Image &stacked, int expansion)
+{
+    for (int r = 0; r < expected.height; ++r)
+    {
+        for (int c = 0; c < expected.width; ++c)
+        {
+            int sc = c * expansion;
+            int bit = s1.pixels[r][sc] ^ s2.pixels[r][sc];
+            if (bit != expected.pixels[r][c])
+                return false;
+            if (stacked.width > 0 && expected.pixels[r][c] == 1)
+            {
+                for (int k = 0; k < expansion; ++k)
+                    if (stacked.pixels[r][sc + k] != 1)
+                        return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool sameImage(const Image &a, const Image &b)
+{
+    return a.width == b.width && a.height == b.height && a.pixels == b.pixels;
+}
+
+// Plain per-pixel bilinear stretch: the reference for DHCOD's streaming
+// RowSampler (same centre-aligned 1/256-pixel positions and rounding, but no
+// column tables, no separate vertical pass and no SIMD).
+int bilinearTap(int i, int outSize, int srcSize, int &frac)
+{
+    long long pos = ((2LL * i + 1) * srcSize * 256) / (2LL * outSize) - 128;
+    if (pos < 0)
+        pos = 0;
+    int i0 = (int)(pos >> 8);
+    frac = (int)(pos & 255);
+    if (i0 >= srcSize - 1)
+    {
+        i0 = srcSize - 1;
+        frac = 0;
+    }
+    return i0;
+}
+
+Image referenceBilinear(const Image &src, int w, int h)
+{
+    Image out(w, h);
+    Scheduler::parallelRows(h, [&](int r0, int r1)
+                            {
+        for (int y = r0; y < r1; ++y)
+        {
+            int fy;
+            int y0 = bilinearTap(y, h, src.height, fy);
+            const std::vector<int> &a = src.pixels[y0];
+            const std::vector<int> &b = src.pixels[fy ? y0 + 1 : y0];
+            for (int x = 0; x < w; ++x)
+            {
+                int fx;
+                int x0 = bilinearTap(x, w, src.width, fx);
+                int x1 = fx ? x0 + 1 : x0;
+                int left = a[x0] * (256 - fy) + b[x0] * fy;
+                int right = a[x1] * (256 - fy) + b[x1] * fy;
+                out.pixels[y][x] = (left * (256 - fx) + right * fx + (1 << 15)) >> 16;
+            }
+        } });
+    return out;
+}
+
+struct Result
+{
+    std::string key; // scheme/pattern/size
+    double seconds;
+    double mpixPerSec;
+    double rssMB;
+    bool correct;
+    int threads;
+
+    Result() : seconds(0), mpixPerSec(0), rssMB(0), correct(false), threads(0) {}
+};
+
+std::string runKey(const std::string &scheme, const Generator &gen, int n)
+{
+    std::ostringstream key;
+    key << scheme << "/" << gen.name << "/" << n << "x" << n;
+    return key.str();
+}
+
+Result runScheme(const std::string &scheme, const Generator &gen, const Image &secret, const Image &cover)
+{
+    Result res;
+    res.key = runKey(scheme, gen, secret.width);
+
+    Image s1(0, 0), s2(0, 0), dec(0, 0);
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    if (scheme == "vcs")
+    {
+        VCS::generateSharesFromGray(secret, 128, s1, s2);
+        dec = VCS::decryptShares(s1, s2);
+    }
+    else if (scheme == "rg")
+    {
+        RG::generateShares(binarizeImage(secret), s1, s2);
+        dec = RG::decryptShares(s1, s2);
+    }
+    else
+    {
+        DHCOD::generateShares(secret, cover, s1, s2);
+        dec = DHCOD::decryptShares(s1, s2);
+    }
+    res.seconds = secondsSince(t0);
+    res.mpixPerSec = (double)secret.width * secret.height / 1e6 / (res.seconds > 0 ? res.seconds : 1e-9);
+    res.rssMB = peakRssMB();
+
+    // Correctness (not timed)
+    if (scheme == "dhcod")
+    {
+        // DHCOD halftones the secret itself, so its XOR decryption has to
+        // reproduce halftoneImage(secret) exactly, and share 1 has to be the
+        // halftoned cover, stretched to the secret's size.
+        Image expected = halftoneImage(secret);
+        Image coverShare = halftoneImage(referenceBilinear(cover, secret.width, secret.height));
+        res.correct = sameImage(expected, dec) && sameImage(coverShare, s1);
+    }
+    else
+    {
+        res.correct = checkShares(binarizeImage(secret), s1, s2, dec, scheme == "vcs" ? 2 : 1);
+    }
+    return res;
+}
+
+// Runs too large for Image go through the C API strip by strip: each strip
+// of secret (and cover) rows is rendered, encrypted, decrypted and checked,
+// then the buffers are reused, so memory stays flat whatever the size.
+// DHCOD gets a same-size cover here, since a strip cannot stretch a cover
+// over the whole image. Strips start on multiples of 4 rows so the Bayer
+// rows line up with a whole-image run.
+Result runStreamed(const std::string &scheme, const Generator &gen, int n)
+{
+    Result res;
+    res.key = runKey(scheme, gen, n);
+
+    vcsg_scheme id = scheme == "vcs" ? VCSG_SCHEME_VCS : scheme == "rg" ? VCSG_SCHEME_RG : VCSG_SCHEME_DHCOD;
+    bool dhcod = (id == VCSG_SCHEME_DHCOD);
+    int e = (id == VCSG_SCHEME_VCS) ? 2 : 1;
+    int sw = n * e;
+    int strip = 4 * Scheduler::threadCount() * Scheduler::kTileRows;
+    if (strip < 256)
+        strip = 256;
+
+    std::vector<unsigned char> secret((size_t)strip * n), cover(dhcod ? (size_t)strip * n : 0);
+    std::vector<unsigned char> s1((size_t)strip * sw), s2((size_t)strip * sw), dec((size_t)strip * sw);
+    std::atomic<bool> ok(true);
+
+    for (int y0 = 0; y0 < n && ok; y0 += strip)
+    {
+        int rows = (n - y0 < strip) ? n - y0 : strip;
+        Scheduler::parallelRows(rows, [&](int r0, int r1)
+                                {
+            for (int r = r0; r < r1; ++r)
+                for (int c = 0; c < n; ++c)
+                {
+                    secret[(size_t)r * n + c] = (unsigned char)gen.pixel(c, y0 + r, n, n);
+                    if (dhcod)
+                        cover[(size_t)r * n + c] = (unsigned char)kSecrets[3].pixel(c, y0 + r, n, n);
+                } });
+
+        vcsg_buffer sb = {&secret[0], n, n, rows, VCSG_GRAY8};
+        vcsg_buffer cb = {dhcod ? &cover[0] : 0, n, n, rows, VCSG_GRAY8};
+        vcsg_buffer a = {&s1[0], sw, sw, rows, VCSG_BINARY8};
+        vcsg_buffer b = {&s2[0], sw, sw, rows, VCSG_BINARY8};
+        vcsg_buffer d = {&dec[0], sw, sw, rows, VCSG_BINARY8};
+
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        int rc = vcsg_generate(id, &sb, dhcod ? &cb : 0, 0, &a, &b);
+        if (rc == VCSG_OK)
+            rc = vcsg_decrypt(id, &a, &b, &d);
+        res.seconds += secondsSince(t0);
+        if (rc != VCSG_OK)
+        {
+            std::cerr << "Error: " << res.key << ": " << vcsg_status_string(rc) << std::endl;
+            ok = false;
+            break;
+        }
+
+        // Same checks as checkShares / halftoneImage on the Image path
+        Scheduler::parallelRows(rows, [&](int r0, int r1)
+                                {
+            std::vector<unsigned char> expected(n);
+            for (int r = r0; r < r1 && ok; ++r)
+            {
+                const unsigned char *in = &secret[(size_t)r * n];
+                const unsigned char *x1 = &s1[(size_t)r * sw];
+                const unsigned char *x2 = &s2[(size_t)r * sw];
+                const unsigned char *st = &dec[(size_t)r * sw];
+                if (dhcod)
+                {
+                    halftoneRow(in, n, r, &expected[0]);
+                    for (int c = 0; c < n; ++c)
+                        if (st[c] != expected[c])
+                            ok = false;
+                    // Same-size cover: share 1 is just its halftone
+                    halftoneRow(&cover[(size_t)r * n], n, r, &expected[0]);
+                    for (int c = 0; c < n; ++c)
+                        if (x1[c] != expected[c])
+                            ok = false;
+                    continue;
+                }
+                for (int c = 0; c < n; ++c)
+                {
+                    int black = in[c] < 128;
+                    if ((x1[c * e] ^ x2[c * e]) != black)
+                        ok = false;
+                    for (int k = 0; black && k < e; ++k)
+                        if (st[c * e + k] != 1)
+                            ok = false;
+                }
+            } });
+    }
+
+    res.correct = ok;
+    res.mpixPerSec = (double)n * n / 1e6 / (res.seconds > 0 ? res.seconds : 1e-9);
+    return res;
+}
+
+// One run, inputs included, in the current process.
+Result runOne(const std::string &scheme, const Generator &gen, int n)
+{
+    Result res;
+    if (n > kMaxImageSide)
+    {
+        res = runStreamed(scheme, gen, n);
+    }
+    else
+    {
+        // Cover at 3/4 size, so DHCOD also exercises its streaming resampler.
+        int coverSide = (n * 3) / 4 > 0 ? (n * 3) / 4 : 1;
+        Image cover = render(kSecrets[3], coverSide, coverSide);
+        Image secret = render(gen, n, n);
+        res = runScheme(scheme, gen, secret, cover);
+    }
+    res.rssMB = peakRssMB();
+    res.threads = Scheduler::threadCount();
+    return res;
+}
+
+// ru_maxrss is a process-wide high-water mark, so each run gets a fresh
+// child process (the parent never starts the worker pool, which does not
+// survive fork). Windows runs in-process and does not measure RSS.
+Result runIsolated(const std::string &scheme, const Generator &gen, int n, int threads)
+{
+#ifdef _WIN32
+    (void)threads;
+    return runOne(scheme, gen, n);
+#else
+    Result res;
+    res.key = runKey(scheme, gen, n);
+
+    int fds[2];
+    if (pipe(fds) != 0)
+        return res;
+    std::cout.flush();
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        close(fds[0]);
+        if (threads > 0)
+            Scheduler::setThreadCount(threads);
+        Result r = runOne(scheme, gen, n);
+        std::ostringstream out;
+        out << std::setprecision(17) << r.seconds << " " << r.mpixPerSec << " " << r.rssMB << " "
+            << (r.correct ? 1 : 0) << " " << r.threads << "\n";
+        std::string msg = out.str();
+        ssize_t rc = write(fds[1], msg.data(), msg.size());
+        _exit(rc == (ssize_t)msg.size() ? 0 : 1);
+    }
+    close(fds[1]);
+    std::string msg;
+    char buf[256];
+    ssize_t got;
+    while ((got = read(fds[0], buf, sizeof(buf))) > 0)
+        msg.append(buf, got);
+    close(fds[0]);
+    int status = 0;
+    if (pid > 0)
+        waitpid(pid, &status, 0);
+
+    std::istringstream in(msg);
+    int correct = 0;
+    if (pid > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0 &&
+        (in >> res.seconds >> res.mpixPerSec >> res.rssMB >> correct >> res.threads))
+        res.correct = (correct != 0);
+    else
+        std::cerr << "Error: " << res.key << " did not finish (out of memory?)" << std::endl;
+    return res;
+#endif
+}
+
+// ---------------------------------------------------------------------------
+// Baselines: one line per run, "key minMpixPerSec maxRssMB".
+
+std::map<std::string, std::pair<double, double>> loadBaseline(const std::string &filename)
+{
+    std::map<std::string, std::pair<double, double>> base;
+    std::ifstream file(filename);
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.empty() || line[0] == '#')
+            continue;
+        std::istringstream in(line);
+        std::string key;
+        double mpix, rss;
+        if (in >> key >> mpix >> rss)
+            base[key] = std::make_pair(mpix, rss);
+    }
+    return base;
+}
+
+std::vector<int> parseSizes(const std::string &list)
+{
+    std::vector<int> sizes;
+    std::istringstream in(list);
+    std::string item;
+    while (std::getline(in, item, ','))
+        sizes.push_back(atoi(item.c_str()));
+    return sizes;
+}
+
+void printUsage()
+{
+    std::cout << "Usage: bench [options]" << std::endl;
+    std::cout << "  --sizes N,N,...      Square sizes to run (default 256,1024,2048; max 65536," << std::endl;
+    std::cout << "                       sizes above 8192 are streamed in strips through the C API)" << std::endl;
+    std::cout << "  --threads N          Worker threads" << std::endl;
+    std::cout << "  --baseline FILE      Fail if a run is slower / uses more memory than FILE allows" << std::endl;
+    std::cout << "  --tolerance F        Allowed regression vs baseline (default 0.25 = 25%)" << std::endl;
+    std::cout << "  --save-baseline FILE Write this run's results as a new baseline" << std::endl;
+    std::cout << "  --min-mpix F         Fail any run below F megapixels/second" << std::endl;
+    std::cout << "  --max-rss-mb F       Fail if peak RSS goes above F MB" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    srand(time(0));
+
+    std::vector<int> sizes = parseSizes("256,1024,2048");
+    std::string baselineFile, saveFile;
+    double tolerance = 0.25, minMpix = 0.0, maxRss = 0.0;
+    int threads = 0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--sizes" && hasValue)
+            sizes = parseSizes(argv[++i]);
+        else if (arg == "--threads" && hasValue)
+            threads = atoi(argv[++i]);
+        else if (arg == "--baseline" && hasValue)
+            baselineFile = argv[++i];
+        else if (arg == "--tolerance" && hasValue)
+            tolerance = atof(argv[++i]);
+        else if (arg == "--save-baseline" && hasValue)
+            saveFile = argv[++i];
+        else if (arg == "--min-mpix" && hasValue)
+            minMpix = atof(argv[++i]);
+        else if (arg == "--max-rss-mb" && hasValue)
+            maxRss = atof(argv[++i]);
+        else
+        {
+            printUsage();
+            return (arg == "--help") ? 0 : 2;
+        }
+    }
+    for (size_t i = 0; i < sizes.size(); ++i)
+    {
+        if (sizes[i] < 1 || sizes[i] > kMaxSide)
+        {
+            std::cerr << "Error: size " << sizes[i] << " out of range (1-" << kMaxSide << ")" << std::endl;
+            return 2;
+        }
+    }
+
+    std::map<std::string, std::pair<double, double>> baseline;
+    if (!baselineFile.empty())
+    {
+        baseline = loadBaseline(baselineFile);
+        if (baseline.empty())
+        {
+            std::cerr << "Error: no entries in baseline " << baselineFile << std::endl;
+            return 2;
+        }
+    }
+
+#ifdef _WIN32
+    if (threads > 0)
+        Scheduler::setThreadCount(threads);
+#endif
+
+    const char *schemes[] = {"vcs", "rg", "dhcod"};
+    std::vector<Result> results;
+    int failures = 0;
+
+    for (size_t si = 0; si < sizes.size(); ++si)
+    {
+        int n = sizes[si];
+        for (size_t g = 0; g < sizeof(kSecrets) / sizeof(kSecrets[0]); ++g)
+        {
+            for (int s = 0; s < 3; ++s)
+            {
+                Result res = runIsolated(schemes[s], kSecrets[g], n, threads);
+                results.push_back(res);
+
+                // Header once the first child has reported the pool size
+                if (results.size() == 1)
+                {
+                    std::cout << "Scalability Benchmark (" << res.threads << " threads)" << std::endl;
+                    std::cout << "=================================================" << std::endl;
+                    std::cout << std::fixed << std::setprecision(2);
+                    std::cout << std::left << std::setw(28) << "Run" << std::right << std::setw(10) << "Time(s)"
+                              << std::setw(10) << "Mpix/s" << std::setw(12) << "PeakRSS(MB)" << "  Check" << std::endl;
+                }
+
+                std::string verdict = res.correct ? "ok" : "WRONG";
+                if (minMpix > 0 && res.mpixPerSec < minMpix)
+                    verdict += " SLOW";
+                if (maxRss > 0 && res.rssMB > maxRss)
+                    verdict += " RSS";
+                std::map<std::string, std::pair<double, double>>::const_iterator it = baseline.find(res.key);
+                if (it != baseline.end())
+                {
+                    if (res.mpixPerSec < it->second.first * (1.0 - tolerance))
+                        verdict += " SLOWER-THAN-BASELINE";
+                    if (res.rssMB > it->second.second * (1.0 + tolerance))
+                        verdict += " RSS-ABOVE-BASELINE";
+                }
+                if (verdict != "ok")
+                    failures++;
+
+                std::cout << std::left << std::setw(28) << res.key << std::right << std::setw(10) << res.seconds
+                          << std::setw(10) << res.mpixPerSec << std::setw(12) << res.rssMB << "  " << verdict << std::endl;
+            }
+        }
+    }
+
+    if (!saveFile.empty())
+    {
+        std::ofstream out(saveFile);
+        out << "# run  min_mpix_per_sec  max_rss_mb\n";
+        out << std::fixed << std::setprecision(2);
+        for (size_t i = 0; i < results.size(); ++i)
+            out << results[i].key << " " << results[i].mpixPerSec << " " << results[i].rssMB << "\n";
+        std::cout << "\nBaseline written to " << saveFile << std::endl;
+    }
+
+    if (failures > 0)
+    {
+        std::cout << "\nFAILED: " << failures << " run(s) wrong or regressed." << std::endl;
+        return 1;
+    }
+    std::cout << "\nAll runs passed." << std::endl;
+    return 0;
+}
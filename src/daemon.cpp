@@ -0,0 +1,499 @@
+#include "daemon.hpp"
+#include <iostream>
+
+#ifdef _WIN32
+
+namespace Daemon {
+
+    int run(const std::string& socketPath) {
+        (void)socketPath;
+        std::cerr << "Error: daemon mode needs Unix domain sockets (not available on Windows)" << std::endl;
+        return 1;
+    }
+
+}
+
+#else
+
+#include "image_utils.hpp"
+#include "vcs.hpp"
+#include "rg.hpp"
+#include "dhcod.hpp"
+#include "scheduler.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <csignal>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace Daemon {
+
+    namespace {
+
+        // Largest accepted image (pixels), so a bad header can't make us
+        // allocate gigabytes.
+        const long kMaxPixels = 1L << 28;
+        const int kPollMs = 200;
+
+        // Connections served at once; more are answered "ERR busy" and closed
+        // (each one may hold a few hundred MB while its request runs).
+        const int kMaxConnections = 32;
+
+        // A connection's payload buffer is kept between its requests only up
+        // to this size.
+        const size_t kKeepBuffer = 16u << 20;
+
+        volatile std::sig_atomic_t g_stop = 0;
+        void onSignal(int) { g_stop = 1; }
+
+        struct Job {
+            std::string scheme;
+            int threshold;
+            Image secret, cover;
+            Image share1, share2;
+            bool done;
+            bool failed;    // the scheme threw (e.g. out of memory)
+            std::mutex mtx;
+            std::condition_variable cv;
+
+            Job() : threshold(128), secret(0, 0), cover(0, 0), share1(0, 0), share2(0, 0),
+                    done(false), failed(false) {}
+        };
+
+        // Requests with at most this many secret pixels are small: the ones
+        // waiting together are coalesced, up to kBatchJobs per Scheduler
+        // task, and each runs its tiles inline in that task (no per-tile
+        // tasks, no waiting inside the pool). Larger requests spread their
+        // tiles over the pool from their connection thread.
+        const long kSmallPixels = 256 * 256;
+        const size_t kBatchJobs = 16;
+
+        std::mutex g_batchMutex;
+        std::deque<Job*> g_pending;   // small jobs not picked up yet
+        int g_batchTasks = 0;         // batch tasks queued or running
+
+        std::atomic<int> g_activeConnections(0);
+
+        // Returns false if the scheme threw (e.g. out of memory).
+        bool generate(Job& job) {
+            try {
+                if (job.scheme == "vcs") {
+                    VCS::generateSharesFromGray(job.secret, job.threshold, job.share1, job.share2);
+                } else if (job.scheme == "rg") {
+                    RG::generateShares(binarizeImage(job.secret, job.threshold), job.share1, job.share2);
+                } else {
+                    DHCOD::generateShares(job.secret, job.cover, job.share1, job.share2);
+                }
+            } catch (...) {
+                return false;
+            }
+            return true;
+        }
+
+        // One batch: the next few small jobs, one after another. If more are
+        // waiting afterwards it hands them to a new task rather than looping,
+        // so a thread that runs it while waiting for its own tiles gets back
+        // to them after a bounded amount of work.
+        void runBatch() {
+            while (true) {
+                std::vector<Job*> batch;
+                {
+                    std::lock_guard<std::mutex> lock(g_batchMutex);
+                    while (!g_pending.empty() && batch.size() < kBatchJobs) {
+                        batch.push_back(g_pending.front());
+                        g_pending.pop_front();
+                    }
+                }
+                for (size_t i = 0; i < batch.size(); ++i) {
+                    Job* job = batch[i];
+                    bool ok;
+                    {
+                        Scheduler::InlineScope inlineTiles;
+                        ok = generate(*job);
+                    }
+                    std::lock_guard<std::mutex> lock(job->mtx);
+                    job->failed = !ok;
+                    job->done = true;
+                    job->cv.notify_one();
+                }
+
+                std::lock_guard<std::mutex> lock(g_batchMutex);
+                if (g_pending.empty()) {
+                    g_batchTasks--;
+                    return;
+                }
+                try {
+                    Scheduler::submit(runBatch); // takes over this task's slot
+                    return;
+                } catch (...) {
+                    // Out of memory: carry on with the next batch here
+                }
+            }
+        }
+
+        void runJob(Job& job) {
+            if ((long)job.secret.width * job.secret.height > kSmallPixels) {
+                job.failed = !generate(job);
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock(g_batchMutex);
+                g_pending.push_back(&job);
+                // At most one batch task per worker; the running ones pick up
+                // whatever queues behind them.
+                if (g_batchTasks < Scheduler::threadCount()) {
+                    try {
+                        Scheduler::submit(runBatch);
+                    } catch (...) {
+                        g_pending.pop_back();
+                        throw;
+                    }
+                    g_batchTasks++;
+                }
+            }
+            std::unique_lock<std::mutex> lock(job.mtx);
+            job.cv.wait(lock, [&job] { return job.done; });
+        }
+
+        // Wait until fd is ready for events (POLLIN/POLLOUT); false on
+        // shutdown or error. Every blocking read and write goes through here,
+        // so a stalled client can't hold up SIGTERM.
+        bool waitReady(int fd, short events) {
+            while (!g_stop) {
+                struct pollfd p;
+                p.fd = fd;
+                p.events = events;
+                p.revents = 0;
+                int rc = poll(&p, 1, kPollMs);
+                if (rc > 0) return true;
+                if (rc < 0 && errno != EINTR) return false;
+            }
+            return false;
+        }
+
+        bool waitReadable(int fd) {
+            return waitReady(fd, POLLIN);
+        }
+
+        // Buffered reads on one connection: a header line costs one read()
+        // per chunk instead of one poll() + read() per byte.
+        struct Reader {
+            int fd;
+            unsigned char buf[4096];
+            size_t pos, end;
+
+            explicit Reader(int fd_) : fd(fd_), pos(0), end(0) {}
+        };
+
+        // One read() into dst; false on EOF, error or shutdown.
+        bool readSome(int fd, unsigned char* dst, size_t n, size_t& got) {
+            while (true) {
+                if (!waitReadable(fd)) return false;
+                ssize_t rc = read(fd, dst, n);
+                if (rc == 0) return false;
+                if (rc < 0) {
+                    if (errno == EINTR || errno == EAGAIN) continue;
+                    return false;
+                }
+                got = (size_t)rc;
+                return true;
+            }
+        }
+
+        bool readFull(Reader& in, unsigned char* buf, size_t n) {
+            size_t got = 0;
+            while (got < n) {
+                if (in.pos < in.end) {
+                    size_t k = (in.end - in.pos < n - got) ? in.end - in.pos : n - got;
+                    memcpy(buf + got, in.buf + in.pos, k);
+                    in.pos += k;
+                    got += k;
+                    continue;
+                }
+                // Buffer empty: large payloads go straight to the destination
+                size_t rc;
+                if (n - got >= sizeof(in.buf)) {
+                    if (!readSome(in.fd, buf + got, n - got, rc)) return false;
+                    got += rc;
+                } else {
+                    if (!readSome(in.fd, in.buf, sizeof(in.buf), rc)) return false;
+                    in.pos = 0;
+                    in.end = rc;
+                }
+            }
+            return true;
+        }
+
+        bool writeFull(int fd, const void* data, size_t n) {
+            const char* p = (const char*)data;
+            while (n > 0) {
+                if (!waitReady(fd, POLLOUT)) return false;
+                ssize_t rc = send(fd, p, n, MSG_DONTWAIT);
+                if (rc < 0) {
+                    if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) continue;
+                    return false;
+                }
+                p += rc;
+                n -= (size_t)rc;
+            }
+            return true;
+        }
+
+        bool readLine(Reader& in, std::string& line) {
+            line.clear();
+            while (line.size() < 512) {
+                if (in.pos == in.end) {
+                    size_t rc;
+                    if (!readSome(in.fd, in.buf, sizeof(in.buf), rc)) return false;
+                    in.pos = 0;
+                    in.end = rc;
+                }
+                const unsigned char* start = in.buf + in.pos;
+                const unsigned char* nl = (const unsigned char*)memchr(start, '\n', in.end - in.pos);
+                size_t k = nl ? (size_t)(nl - start) : in.end - in.pos;
+                line.append((const char*)start, k);
+                in.pos += k;
+                if (nl) {
+                    in.pos++; // the newline
+                    return line.size() <= 512;
+                }
+            }
+            return false;
+        }
+
+        void fillImage(Image& img, int w, int h, const unsigned char* bytes) {
+            img = Image(w, h);
+            for (int r = 0; r < h; ++r) {
+                for (int c = 0; c < w; ++c) img.pixels[r][c] = bytes[(size_t)r * w + c];
+            }
+        }
+
+        // Map a shared memory object and copy the secret/cover out of it.
+        bool readShm(const std::string& name, Job& job, int w, int h, int cw, int ch, std::string& error) {
+            size_t need = (size_t)w * h + (size_t)cw * ch;
+            int fd = shm_open(name.c_str(), O_RDONLY, 0);
+            if (fd < 0) {
+                error = "cannot open shared memory " + name;
+                return false;
+            }
+            struct stat st;
+            if (fstat(fd, &st) != 0 || (size_t)st.st_size < need) {
+                close(fd);
+                error = "shared memory " + name + " is too small";
+                return false;
+            }
+            void* mem = mmap(0, need, PROT_READ, MAP_SHARED, fd, 0);
+            close(fd);
+            if (mem == MAP_FAILED) {
+                error = "cannot map shared memory " + name;
+                return false;
+            }
+            const unsigned char* bytes = (const unsigned char*)mem;
+            fillImage(job.secret, w, h, bytes);
+            fillImage(job.cover, cw, ch, bytes + (size_t)w * h);
+            munmap(mem, need);
+            return true;
+        }
+
+        // Kept per connection thread and reused across its requests.
+        thread_local std::vector<unsigned char> t_buffer;
+
+        bool sendShares(int fd, const Image& s1, const Image& s2) {
+            std::ostringstream hdr;
+            hdr << "OK " << s1.width << " " << s1.height << " " << s2.width << " " << s2.height << "\n";
+            std::string line = hdr.str();
+            if (!writeFull(fd, line.data(), line.size())) return false;
+
+            const Image* shares[2] = { &s1, &s2 };
+            for (int s = 0; s < 2; ++s) {
+                const Image& img = *shares[s];
+                t_buffer.resize((size_t)img.width * img.height);
+                for (int r = 0; r < img.height; ++r) {
+                    unsigned char* out = &t_buffer[(size_t)r * img.width];
+                    // Internal 1 = Black -> 0, 0 = White -> 255 (as in savePGM)
+                    for (int c = 0; c < img.width; ++c) out[c] = img.pixels[r][c] ? 0 : 255;
+                }
+                if (!writeFull(fd, t_buffer.data(), t_buffer.size())) return false;
+            }
+            return true;
+        }
+
+        bool sendError(int fd, const std::string& message) {
+            std::string line = "ERR " + message + "\n";
+            return writeFull(fd, line.data(), line.size());
+        }
+
+        // Handle one request. Returns false when the connection should close.
+        bool handleRequest(Reader& reader, const std::string& line) {
+            int fd = reader.fd;
+            std::istringstream in(line);
+            std::string cmd;
+            in >> cmd;
+
+            if (cmd == "PING") return writeFull(fd, "OK\n", 3);
+            if (cmd != "ENCRYPT" && cmd != "ENCRYPT_SHM") {
+                sendError(fd, "unknown command");
+                return false;
+            }
+
+            Job job;
+            int w = 0, h = 0, cw = 0, ch = 0;
+            std::string shmName;
+            in >> job.scheme >> w >> h >> cw >> ch >> job.threshold;
+            if (cmd == "ENCRYPT_SHM") in >> shmName;
+
+            // A malformed header leaves the byte stream out of sync: close.
+            if (!in || (cmd == "ENCRYPT_SHM" && shmName.empty())) {
+                sendError(fd, "malformed request");
+                return false;
+            }
+            if (w <= 0 || h <= 0 || cw < 0 || ch < 0 ||
+                (long)w * h > kMaxPixels || (long)cw * ch > kMaxPixels) {
+                sendError(fd, "bad image size");
+                return false;
+            }
+
+            std::string error;
+            if (job.scheme != "vcs" && job.scheme != "rg" && job.scheme != "dhcod") {
+                error = "unknown scheme " + job.scheme;
+            } else if (job.scheme == "dhcod" && (cw == 0 || ch == 0)) {
+                error = "dhcod needs a cover image";
+            }
+
+            if (cmd == "ENCRYPT") {
+                // Always drain the payload so the next request lines up.
+                t_buffer.resize((size_t)w * h + (size_t)cw * ch);
+                if (!readFull(reader, t_buffer.data(), t_buffer.size())) return false;
+                if (error.empty()) {
+                    fillImage(job.secret, w, h, t_buffer.data());
+                    fillImage(job.cover, cw, ch, t_buffer.data() + (size_t)w * h);
+                }
+            } else if (error.empty()) {
+                readShm(shmName, job, w, h, cw, ch, error);
+            }
+            if (!error.empty()) return sendError(fd, error);
+
+            runJob(job);
+            if (job.failed) return sendError(fd, "out of memory");
+            return sendShares(fd, job.share1, job.share2);
+        }
+
+        void serveConnection(int fd) {
+            Reader reader(fd);
+            std::string line;
+            while (!g_stop && readLine(reader, line)) {
+                // Running out of memory fails this request, not the daemon.
+                // The payload may be half read, so the connection closes too.
+                bool keep;
+                try {
+                    keep = handleRequest(reader, line);
+                } catch (const std::bad_alloc&) {
+                    sendError(fd, "out of memory");
+                    keep = false;
+                }
+                if (t_buffer.capacity() > kKeepBuffer) std::vector<unsigned char>().swap(t_buffer);
+                if (!keep) break;
+            }
+            std::vector<unsigned char>().swap(t_buffer);
+            close(fd);
+            g_activeConnections--;
+        }
+    }
+
+    int run(const std::string& socketPath) {
+        struct sockaddr_un addr;
+        if (socketPath.size() >= sizeof(addr.sun_path)) {
+            std::cerr << "Error: socket path too long: " << socketPath << std::endl;
+            return 1;
+        }
+
+        int listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listenFd < 0) {
+            std::cerr << "Error: Could not create socket" << std::endl;
+            return 1;
+        }
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+
+        // Only replace a stale socket: never another kind of file, and never
+        // the socket of a daemon that is still answering.
+        struct stat st;
+        if (lstat(socketPath.c_str(), &st) == 0) {
+            if (!S_ISSOCK(st.st_mode)) {
+                std::cerr << "Error: " << socketPath << " exists and is not a socket" << std::endl;
+                close(listenFd);
+                return 1;
+            }
+            int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+            bool live = probe >= 0 && connect(probe, (struct sockaddr*)&addr, sizeof(addr)) == 0;
+            if (probe >= 0) close(probe);
+            if (live) {
+                std::cerr << "Error: a daemon is already listening on " << socketPath << std::endl;
+                close(listenFd);
+                return 1;
+            }
+            unlink(socketPath.c_str()); // stale socket from a previous run
+        }
+        if (bind(listenFd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(listenFd, 64) != 0) {
+            std::cerr << "Error: Could not listen on " << socketPath << std::endl;
+            close(listenFd);
+            return 1;
+        }
+
+        signal(SIGPIPE, SIG_IGN); // a client hanging up must not kill the daemon
+        signal(SIGINT, onSignal);
+        signal(SIGTERM, onSignal);
+
+        Scheduler::threadCount(); // start the workers now rather than on the first request
+
+        std::cout << "Listening on " << socketPath << " (" << Scheduler::threadCount()
+                  << " worker threads). Ctrl+C to stop." << std::endl;
+
+        while (!g_stop) {
+            if (!waitReadable(listenFd)) break;
+            int fd = accept(listenFd, 0, 0);
+            if (fd < 0) continue;
+            if (g_activeConnections >= kMaxConnections) {
+                sendError(fd, "busy");
+                close(fd);
+                continue;
+            }
+            g_activeConnections++;
+            try {
+                std::thread(serveConnection, fd).detach();
+            } catch (const std::exception&) { // out of threads or memory
+                sendError(fd, "busy");
+                close(fd);
+                g_activeConnections--;
+            }
+        }
+
+        close(listenFd);
+        unlink(socketPath.c_str());
+
+        // Connections notice g_stop within one poll interval.
+        while (g_activeConnections > 0) usleep(kPollMs * 1000);
+
+        std::cout << "Daemon stopped." << std::endl;
+        return 0;
+    }
+
+}
+
+#endif // _WIN32
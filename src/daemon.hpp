@@ -0,0 +1,40 @@
+#ifndef DAEMON_HPP
+#define DAEMON_HPP
+
+#include <string>
+
+namespace Daemon {
+    // Long-running server mode: listen on a Unix domain socket and answer
+    // encryption requests without touching the disk.
+    // Each connection may send any number of requests, one after another.
+    //
+    // Request (one header line, then raw bytes):
+    //   ENCRYPT <vcs|rg|dhcod> <w> <h> <coverW> <coverH> <threshold>\n
+    //     followed by w*h secret bytes and coverW*coverH cover bytes
+    //     (8-bit grayscale, row-major; coverW = coverH = 0 for vcs/rg;
+    //     a dhcod cover of another size is stretched to the secret's size).
+    //   ENCRYPT_SHM <vcs|rg|dhcod> <w> <h> <coverW> <coverH> <threshold> <shmName>\n
+    //     same, but the secret and cover bytes are read from the POSIX
+    //     shared memory object shmName (secret first, then cover).
+    //   PING\n
+    //
+    // Response:
+    //   OK <w1> <h1> <w2> <h2>\n followed by share1 and share2 bytes
+    //     (PGM convention: 0 = black, 255 = white).
+    //   OK\n for PING, or ERR <message>\n.
+    //   A request that runs out of memory gets "ERR out of memory" and its
+    //   connection is closed; beyond 32 open connections new ones get
+    //   "ERR busy" and are closed right away.
+    //
+    // Everything runs on the shared Scheduler, so the worker threads stay
+    // warm between requests. Small requests (up to 256x256 secret pixels)
+    // that arrive together are batched, up to 16 per task, each running
+    // its tiles inline; larger ones spread their tiles over the pool.
+    // Each request is answered as soon as its own shares are ready.
+    // Refuses to start if socketPath is not a socket or another daemon still
+    // answers on it (a stale socket is replaced).
+    // Returns when the process gets SIGINT/SIGTERM; non-zero on setup errors.
+    int run(const std::string& socketPath);
+}
+
+#endif // DAEMON_HPP
@@ -1,61 +1,95 @@
 #include "dhcod.hpp"
+#include <memory>
+#include <vector>
 
 namespace DHCOD {
 
-    void generateShares(const Image& secret, const Image& cover, Image& share1, Image& share2) {
+    void generateShares(const Image& secret, const Image& cover, Image& share1, Image& share2,
+                        Resample::Filter filter, Resample::Fit fit) {
+        Scheduler::waitAll(submitGenerate(secret, cover, share1, share2, filter, fit));
+    }
+
+    std::vector<Scheduler::Task> submitGenerate(const Image& secret, const Image& cover, Image& share1, Image& share2,
+                                                Resample::Filter filter, Resample::Fit fit,
+                                                const std::vector<Scheduler::Task>& after) {
         int w = secret.width;
         int h = secret.height;
-        // Assume cover is same size or resize/crop?
-        // For this project, we assume inputs match.
-        
-        // 1. Process Secret
-        // If secret is already binary (0/1), use as is. Note: 'binarizeImage' creates 0/1.
-        // If it's grayscale, we should probably halftone it to preserve details if it's a photo.
-        // Let's halftone it to be safe/advanced.
-        Image secretBin = halftoneImage(secret);
 
-        // 2. Process Cover -> Halftone to get Share 1
-        Image coverBin = halftoneImage(cover);
-        share1 = coverBin;
+        share1 = Image(w, h);
         share2 = Image(w, h);
+        if (w == 0 || h == 0) return std::vector<Scheduler::Task>();
+        if (cover.width == 0 || cover.height == 0) {
+            std::cerr << "Error: DHCOD needs a non-empty cover image" << std::endl;
+            return std::vector<Scheduler::Task>();
+        }
 
-        for (int r = 0; r < h; ++r) {
-            for (int c = 0; c < w; ++c) {
-                int s_pix = secretBin.pixels[r][c]; // 0=White, 1=Black
-                int c_pix = coverBin.pixels[r][c];  // 0=White, 1=Black
-
-                // Logic:
-                // If Secret is White (0) -> share2 = share1
-                // If Secret is Black (1) -> share2 = NOT share1
-                
-                if (s_pix == 0) { // White
-                    share2.pixels[r][c] = c_pix;
-                } else { // Black
-                    share2.pixels[r][c] = 1 - c_pix; // Invert (0->1, 1->0)
-                }
+        // The cover is fitted to the secret's size on the fly, one row at a
+        // time, as each tile consumes it (identity if the sizes match).
+        // Shared by the tiles, which may outlive this call.
+        std::shared_ptr<Resample::RowSampler<int> > coverRows(
+            new Resample::RowSampler<int>(Resample::rowPointers(cover), cover.width, w, h, filter, fit));
+
+        // Fused per tile: resample cover row -> halftone it (Share 1),
+        // halftone the secret row, then derive Share 2.
+        return Scheduler::submitRows(h, [&secret, &share1, &share2, coverRows, w](int r0, int r1) {
+            std::vector<int> coverRow(w), scratch;
+            for (int r = r0; r < r1; ++r) {
+                coverRows->row(r, &coverRow[0], scratch);
+                encodeRow(&secret.pixels[r][0], &coverRow[0], w, r, &share1.pixels[r][0], &share2.pixels[r][0]);
             }
+        }, after);
+    }
+
+    template <typename In, typename Out>
+    void encodeRow(const In* secretRow, const int* coverRow, int w, int y, Out* s1, Out* s2) {
+        halftoneRow(coverRow, w, y, s1);
+
+        // If secret is already binary (0/1), use as is. Note: 'binarizeImage' creates 0/1.
+        // If it's grayscale, we should probably halftone it to preserve details if it's a photo.
+        // Let's halftone it to be safe/advanced.
+        halftoneRow(secretRow, w, y, s2);
+
+        for (int c = 0; c < w; ++c) {
+            // Logic:
+            // If Secret is White (0) -> share2 = share1
+            // If Secret is Black (1) -> share2 = NOT share1
+            s2[c] = s1[c] ^ s2[c];
         }
     }
 
-    Image decryptShares(const Image& share1, const Image& share2) {
+    template void encodeRow<int, int>(const int*, const int*, int, int, int*, int*);
+    template void encodeRow<unsigned char, unsigned char>(const unsigned char*, const int*, int, int,
+                                                          unsigned char*, unsigned char*);
+
+    Image decryptShares(const Image& share1, const Image& share2, Pyramid::Accumulator* pyramid) {
+        Image result(0, 0);
+        Scheduler::waitAll(submitDecrypt(share1, share2, result, pyramid));
+        return result;
+    }
+
+    std::vector<Scheduler::Task> submitDecrypt(const Image& share1, const Image& share2, Image& result,
+                                               Pyramid::Accumulator* pyramid,
+                                               const std::vector<Scheduler::Task>& after) {
         // Digital Decryption via XOR
         // If s1 == s2 -> XOR is 0 (White). This happens when Secret was White.
         // If s1 != s2 -> XOR is 1 (Black). This happens when Secret was Black.
         int w = share1.width;
         int h = share1.height;
-        Image result(w, h);
-
-        for (int r = 0; r < h; ++r) {
-            for (int c = 0; c < w; ++c) {
-                // XOR
-                if (share1.pixels[r][c] == share2.pixels[r][c]) {
-                    result.pixels[r][c] = 0; // White
-                } else {
-                    result.pixels[r][c] = 1; // Black
+        result = Image(w, h);
+
+        return Scheduler::submitRows(h, [&share1, &share2, &result, pyramid, w](int r0, int r1) {
+            for (int r = r0; r < r1; ++r) {
+                for (int c = 0; c < w; ++c) {
+                    // XOR
+                    if (share1.pixels[r][c] == share2.pixels[r][c]) {
+                        result.pixels[r][c] = 0; // White
+                    } else {
+                        result.pixels[r][c] = 1; // Black
+                    }
                 }
+                if (pyramid) pyramid->addRow(r, &result.pixels[r][0]);
             }
-        }
-        return result;
+        }, after);
     }
 
 }
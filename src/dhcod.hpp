@@ -2,24 +2,49 @@
 #define DHCOD_HPP
 
 #include "image_utils.hpp"
+#include "pyramid.hpp"
+#include "resample.hpp"
+#include "scheduler.hpp"
 
 namespace DHCOD {
     // Generate shares using DHCOD (Meaningful Shares).
     // Input: 
     //   secret: The image to hide (Grayscale or Binary).
-    //   cover: The image to appear on the shares (Grayscale).
+    //   cover: The image to appear on the shares (Grayscale), any size.
+    //   filter, fit: How the cover is fitted to the secret's size when they
+    //     differ. The cover is resampled row by row as the shares are built,
+    //     so no resized copy of it is ever stored.
     // Outputs:
-    //   share1, share2: Meaningful shares looking like 'cover'.
+    //   share1, share2: Meaningful shares looking like 'cover' (secret's size).
     // Logic:
     //   H = secret, X = cover.
     //   X1 = Halftone(X).
     //   H2 = Binary(H) (or Halftone(H)).
     //   If H2 is White (0): X2 = X1.
     //   If H2 is Black (1): X2 = Complement(X1).
-    void generateShares(const Image& secret, const Image& cover, Image& share1, Image& share2);
+    void generateShares(const Image& secret, const Image& cover, Image& share1, Image& share2,
+                        Resample::Filter filter = Resample::BILINEAR,
+                        Resample::Fit fit = Resample::STRETCH);
 
     // Decrypt using XOR (Digital Reconstruction).
-    Image decryptShares(const Image& share1, const Image& share2);
+    // pyramid (optional) collects the stack preview in the same pass.
+    Image decryptShares(const Image& share1, const Image& share2, Pyramid::Accumulator* pyramid = 0);
+
+    // Tile-task forms for pipelining (see VCS::submitGenerateFromGray).
+    // after[i] gates tile i of the secret; the cover must be complete.
+    std::vector<Scheduler::Task> submitGenerate(const Image& secret, const Image& cover, Image& share1, Image& share2,
+                                                Resample::Filter filter = Resample::BILINEAR,
+                                                Resample::Fit fit = Resample::STRETCH,
+                                                const std::vector<Scheduler::Task>& after = std::vector<Scheduler::Task>());
+    std::vector<Scheduler::Task> submitDecrypt(const Image& share1, const Image& share2, Image& result,
+                                               Pyramid::Accumulator* pyramid = 0,
+                                               const std::vector<Scheduler::Task>& after = std::vector<Scheduler::Task>());
+
+    // Row kernel: halftone an already-fitted cover row into s1 and derive s2
+    // from the secret row (y = row index, for the Bayer pattern).
+    // Instantiated for int and unsigned char pixels (the C API uses the latter).
+    template <typename In, typename Out>
+    void encodeRow(const In* secretRow, const int* coverRow, int w, int y, Out* s1, Out* s2);
 }
 
 #endif // DHCOD_HPP
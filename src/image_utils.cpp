@@ -1,4 +1,5 @@
 #include "image_utils.hpp"
+#include "scheduler.hpp"
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -97,19 +98,27 @@ bool savePGM(const std::string& filename, const Image& img) {
     return true;
 }
 
-Image binarizeImage(const Image& input, int threshold) {
-    Image res(input.width, input.height);
-    for (int i = 0; i < input.height; ++i) {
-        for (int j = 0; j < input.width; ++j) {
-            // Standard: val < threshold -> Black (0 in PGM, 1 in Internal)
-            // val >= threshold -> White (255 in PGM, 0 in Internal)
-            res.pixels[i][j] = (input.pixels[i][j] < threshold) ? 1 : 0;
+std::vector<Scheduler::Task> submitBinarize(const Image& input, Image& output, int threshold) {
+    output = Image(input.width, input.height);
+    return Scheduler::submitRows(input.height, [&input, &output, threshold](int r0, int r1) {
+        for (int i = r0; i < r1; ++i) {
+            for (int j = 0; j < input.width; ++j) {
+                // Standard: val < threshold -> Black (0 in PGM, 1 in Internal)
+                // val >= threshold -> White (255 in PGM, 0 in Internal)
+                output.pixels[i][j] = (input.pixels[i][j] < threshold) ? 1 : 0;
+            }
         }
-    }
+    });
+}
+
+Image binarizeImage(const Image& input, int threshold) {
+    Image res(0, 0);
+    Scheduler::waitAll(submitBinarize(input, res, threshold));
     return res;
 }
 
-Image halftoneImage(const Image& input) {
+template <typename In, typename Out>
+void halftoneRow(const In* in, int width, int y, Out* out) {
     // 4x4 Bayer Matrix
     // Values scaled to 0-255 range conceptually (Bayer is 0-15).
     // Threshold = (M[y%4][x%4] + 0.5) * (255/16)
@@ -120,25 +129,42 @@ Image halftoneImage(const Image& input) {
         {15,  7, 13,  5}
     };
 
-    Image res(input.width, input.height);
-    for (int y = 0; y < input.height; ++y) {
-        for (int x = 0; x < input.width; ++x) {
-            int val = input.pixels[y][x];
-            // Since input might be already 0/1, check range.
-            // If input is 0-1, we assume it's already binary-ish, but let's assume 0-255 for grayscale.
-            // Internal 1=Black, 0=White... wait. 
-            // Standard Grayscale PGM: 0=Black, 255=White.
-            // Internal Image: We store raw values from PGM (0-255).
-            // BUT our `binarizeImage` produces 0 or 1.
-            // If we are halftoning, we expect Grayscale inputs (0-255).
-            
-            // Map Bayer (0-15) to 0-255 threshold.
-            int threshold = (bayer[y % 4][x % 4] * 17); // 16 * 16 = 256 approx. 17 * 15 = 255.
-            
-            // If Pixel > Threshold -> White (0 Internal)
-            // If Pixel <= Threshold -> Black (1 Internal)
-            res.pixels[y][x] = (val > threshold) ? 0 : 1;
-        }
+    const int* m = bayer[y % 4];
+    for (int x = 0; x < width; ++x) {
+        int val = in[x];
+        // Since input might be already 0/1, check range.
+        // If input is 0-1, we assume it's already binary-ish, but let's assume 0-255 for grayscale.
+        // Internal 1=Black, 0=White... wait. 
+        // Standard Grayscale PGM: 0=Black, 255=White.
+        // Internal Image: We store raw values from PGM (0-255).
+        // BUT our `binarizeImage` produces 0 or 1.
+        // If we are halftoning, we expect Grayscale inputs (0-255).
+        
+        // Map Bayer (0-15) to 0-255 threshold.
+        int threshold = (m[x % 4] * 17); // 16 * 16 = 256 approx. 17 * 15 = 255.
+        
+        // If Pixel > Threshold -> White (0 Internal)
+        // If Pixel <= Threshold -> Black (1 Internal)
+        out[x] = (val > threshold) ? 0 : 1;
+    }
+}
+
+// Pixel types used by the Image code (int) and the C API (8-bit buffers).
+template void halftoneRow<int, int>(const int*, int, int, int*);
+template void halftoneRow<int, unsigned char>(const int*, int, int, unsigned char*);
+template void halftoneRow<unsigned char, unsigned char>(const unsigned char*, int, int, unsigned char*);
+
+void halftoneRows(const Image& input, Image& output, int rowBegin, int rowEnd) {
+    if (input.width == 0) return;
+    for (int y = rowBegin; y < rowEnd; ++y) {
+        halftoneRow(&input.pixels[y][0], input.width, y, &output.pixels[y][0]);
     }
+}
+
+Image halftoneImage(const Image& input) {
+    Image res(input.width, input.height);
+    Scheduler::parallelRows(input.height, [&](int r0, int r1) {
+        halftoneRows(input, res, r0, r1);
+    });
     return res;
 }
@@ -4,6 +4,7 @@
 #include <vector>
 #include <string>
 #include <iostream>
+#include "scheduler.hpp"
 
 struct Image {
     int width;
@@ -28,8 +29,23 @@ bool savePGM(const std::string& filename, const Image& img);
 // When saving to PGM: 0 -> 255 (White), 1 -> 0 (Black).
 Image binarizeImage(const Image& input, int threshold = 128);
 
+// binarizeImage as one task per Scheduler tile, writing into output (sized
+// here). Task i finishes once rows of tile i are binarized, so the next
+// stage can depend on it tile by tile; input and output must outlive them.
+std::vector<Scheduler::Task> submitBinarize(const Image& input, Image& output, int threshold = 128);
+
 // Halftone an image using Ordered Dithering (Bayer Matrix).
 // Returns a binary image (0=White, 1=Black).
 Image halftoneImage(const Image& input);
 
+// Halftone rows [rowBegin, rowEnd) of input into output (same size).
+// Used by the tile tasks that pipeline halftoning with share generation.
+void halftoneRows(const Image& input, Image& output, int rowBegin, int rowEnd);
+
+// Halftone a single row (y = its row index, which selects the Bayer row).
+// Lets callers halftone pixels they produce on the fly, e.g. a resampled cover,
+// or rows of 8-bit buffers (instantiated for int and unsigned char pixels).
+template <typename In, typename Out>
+void halftoneRow(const In* in, int width, int y, Out* out);
+
 #endif // IMAGE_UTILS_HPP
@@ -3,9 +3,13 @@
 #include <string>
 #include <cstdlib>
 #include <ctime>
+#include <chrono>
 #include "image_utils.hpp"
 #include "vcs.hpp"
 #include "rg.hpp"
+#include "scheduler.hpp"
+#include "pyramid.hpp"
+#include "daemon.hpp"
 
 void createSampleImage(const std::string &filename, int w, int h)
 {
@@ -47,9 +51,143 @@ void createSampleCover(const std::string &filename, int w, int h)
     savePGM(filename, img);
 }
 
+// Progressive preview: print the coarsest stack level first, then refine
+// down to finestLevel. Only the requested levels are read from the file.
+int runPreview(const std::string &pyrFilename, int finestLevel)
+{
+    int levels = Pyramid::levelCount(pyrFilename);
+    if (levels == 0)
+    {
+        std::cerr << "Error: Could not read pyramid " << pyrFilename << std::endl;
+        return 1;
+    }
+
+    std::string base = pyrFilename;
+    if (base.size() > 4 && base.compare(base.size() - 4, 4, ".pyr") == 0)
+        base = base.substr(0, base.size() - 4);
+
+    for (int k = levels; k >= finestLevel && k >= 1; --k)
+    {
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        Image level = Pyramid::loadLevel(pyrFilename, k);
+        if (level.width == 0)
+            return 1;
+        std::string out = base + "_L" + std::to_string(k) + ".pgm";
+        Pyramid::savePreview(out, level);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+        std::cout << "Level " << k << " (1/" << (1 << (2 * k)) << "): " << level.width << " x " << level.height
+                  << " in " << ms << " ms -> " << out << std::endl;
+    }
+    return 0;
+}
+
+// Progressive preview on the decrypt side, straight from the two shares:
+// each level stacks only a sample of rows (coarsest first), so nothing but
+// the shares ever has to hold the secret.
+int runSharePreview(const std::string &share1Filename, const std::string &share2Filename,
+                    const std::string &scheme, int finestLevel)
+{
+    Image s1 = loadPGM(share1Filename);
+    Image s2 = loadPGM(share2Filename);
+    if (s1.width == 0 || s2.width == 0)
+        return 1;
+    if (s1.width != s2.width || s1.height != s2.height)
+    {
+        std::cerr << "Error: shares differ in size" << std::endl;
+        return 1;
+    }
+
+    // Shares are PGM files here (0 = black), the stack wants 1 = Black.
+    for (int r = 0; r < s1.height; ++r)
+        for (int c = 0; c < s1.width; ++c)
+        {
+            s1.pixels[r][c] = s1.pixels[r][c] < 128 ? 1 : 0;
+            s2.pixels[r][c] = s2.pixels[r][c] < 128 ? 1 : 0;
+        }
+
+    std::string base = share1Filename;
+    if (base.size() > 4 && base.compare(base.size() - 4, 4, ".pgm") == 0)
+        base = base.substr(0, base.size() - 4);
+    base += "_preview";
+
+    int xScale = (scheme == "vcs") ? 2 : 1;
+    bool useXor = (scheme == "dhcod");
+    for (int k = Pyramid::kLevels; k >= finestLevel && k >= 1; --k)
+    {
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        Image level = Pyramid::sampleLevel(s1, s2, k, xScale, useXor);
+        std::string out = base + "_L" + std::to_string(k) + ".pgm";
+        Pyramid::savePreview(out, level);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+        std::cout << "Level " << k << " (1/" << (1 << (2 * k)) << "): " << level.width << " x " << level.height
+                  << " in " << ms << " ms -> " << out << std::endl;
+    }
+    return 0;
+}
+
 int main(int argc, char *argv[])
 {
     srand(time(0));
+
+    // Optional: --threads N (otherwise VC_THREADS or all hardware threads)
+    //           --pyramid (also write <scheme>_stack.pyr; it holds the secret, see pyramid.hpp)
+    //           --preview file.pyr [--level K] (show a stack pyramid and exit)
+    //           --preview-shares s1.pgm s2.pgm [--scheme vcs|rg|dhcod] [--level K]
+    //             (coarse-to-fine stack preview from the two shares, then exit)
+    //           --daemon [socket] (serve requests on a Unix socket, see daemon.hpp)
+    //           --resample nearest|bilinear|area, --cover-fit stretch|tile
+    //             (how DHCOD fits a cover whose size differs from the secret)
+    std::string previewFilename;
+    std::string previewShares[2];
+    std::string previewScheme = "vcs";
+    int previewLevel = 1;
+    bool writePyramids = false;
+    bool daemonMode = false;
+    std::string socketPath = "/tmp/vcsg.sock";
+    Resample::Filter coverFilter = Resample::BILINEAR;
+    Resample::Fit coverFit = Resample::STRETCH;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc)
+            Scheduler::setThreadCount(atoi(argv[++i]));
+        else if (arg == "--preview" && i + 1 < argc)
+            previewFilename = argv[++i];
+        else if (arg == "--preview-shares" && i + 2 < argc)
+        {
+            previewShares[0] = argv[++i];
+            previewShares[1] = argv[++i];
+        }
+        else if (arg == "--scheme" && i + 1 < argc)
+            previewScheme = argv[++i];
+        else if (arg == "--pyramid")
+            writePyramids = true;
+        else if (arg == "--level" && i + 1 < argc)
+            previewLevel = atoi(argv[++i]);
+        else if (arg == "--resample" && i + 1 < argc)
+        {
+            std::string v = argv[++i];
+            coverFilter = (v == "nearest") ? Resample::NEAREST : (v == "area") ? Resample::AREA : Resample::BILINEAR;
+        }
+        else if (arg == "--cover-fit" && i + 1 < argc)
+            coverFit = (std::string(argv[++i]) == "tile") ? Resample::TILE : Resample::STRETCH;
+        else if (arg == "--daemon")
+        {
+            daemonMode = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                socketPath = argv[++i];
+        }
+    }
+    if (!previewFilename.empty())
+        return runPreview(previewFilename, previewLevel);
+    if (!previewShares[0].empty())
+        return runSharePreview(previewShares[0], previewShares[1], previewScheme, previewLevel);
+    if (daemonMode)
+        return Daemon::run(socketPath);
+
+    std::cout << "Using " << Scheduler::threadCount() << " worker thread(s)." << std::endl;
     std::string inputFilename = "input/input.pgm";
     std::string coverFilename = "input/cover.pgm";
 
@@ -78,49 +216,67 @@ int main(int argc, char *argv[])
     if (input.width == 0 || cover.width == 0)
         return 1;
 
-    // Resize cover if needed? For now assume user/sample provided correct sizes.
-    // If we generated samples, we simply used 200x200 for both.
+    // The cover may be any size: DHCOD resamples it to the secret's size
+    // (see --resample / --cover-fit).
+    if (cover.width != input.width || cover.height != input.height)
+        std::cout << "Cover is " << cover.width << "x" << cover.height << ", fitting it to "
+                  << input.width << "x" << input.height << " for DHCOD." << std::endl;
 
+    // All stages run as one tile pipeline: a tile's shares wait only for
+    // that tile's binarized rows and its decrypt only for those shares, so
+    // no stage waits for a whole image and the three schemes overlap.
     std::cout << "Binarizing input for VCS/RG..." << std::endl;
-    Image binary = binarizeImage(input);
-    savePGM("output/binary_input.pgm", binary);
+    Image binary(0, 0);
+    std::vector<Scheduler::Task> binaryTiles = submitBinarize(input, binary);
+
+    // VCS thresholds the grayscale input directly (same result as using 'binary').
+    std::cout << "Running (2,2) Visual Cryptography Scheme..." << std::endl;
+    Image vcs_s1(0, 0), vcs_s2(0, 0), vcs_dec(0, 0);
+    std::vector<Scheduler::Task> vcs_tiles = VCS::submitGenerateFromGray(input, 128, vcs_s1, vcs_s2);
+    Pyramid::Accumulator vcs_pyr(vcs_s1.width, vcs_s1.height, 2);
+    vcs_tiles = VCS::submitDecrypt(vcs_s1, vcs_s2, vcs_dec, writePyramids ? &vcs_pyr : 0, vcs_tiles);
+
+    std::cout << "Running (2,2) Random Grid Scheme..." << std::endl;
+    Image rg_s1(0, 0), rg_s2(0, 0), rg_dec(0, 0);
+    std::vector<Scheduler::Task> rg_tiles = RG::submitGenerate(binary, rg_s1, rg_s2, binaryTiles);
+    Pyramid::Accumulator rg_pyr(rg_s1.width, rg_s1.height);
+    rg_tiles = RG::submitDecrypt(rg_s1, rg_s2, rg_dec, writePyramids ? &rg_pyr : 0, rg_tiles);
+
+    // DHCOD takes Grayscale input (handles halftoning internally effectively)
+    std::cout << "Running DHCOD (Meaningful Shares)..." << std::endl;
+    Image dh_s1(0, 0), dh_s2(0, 0), dh_dec(0, 0);
+    std::vector<Scheduler::Task> dh_tiles = DHCOD::submitGenerate(input, cover, dh_s1, dh_s2, coverFilter, coverFit);
+    Pyramid::Accumulator dh_pyr(dh_s1.width, dh_s1.height);
+    dh_tiles = DHCOD::submitDecrypt(dh_s1, dh_s2, dh_dec, writePyramids ? &dh_pyr : 0, dh_tiles);
 
-    // Run VCS
-    std::cout << "\nRunning (2,2) Visual Cryptography Scheme..." << std::endl;
-    Image vcs_s1(0, 0), vcs_s2(0, 0);
-    VCS::generateShares(binary, vcs_s1, vcs_s2);
+    // Wait for everything (and rethrow the first tile failure, if any)
+    std::vector<Scheduler::Task> all(binaryTiles);
+    all.insert(all.end(), vcs_tiles.begin(), vcs_tiles.end());
+    all.insert(all.end(), rg_tiles.begin(), rg_tiles.end());
+    all.insert(all.end(), dh_tiles.begin(), dh_tiles.end());
+    Scheduler::waitAll(all);
 
-    Image vcs_dec = VCS::decryptShares(vcs_s1, vcs_s2);
+    savePGM("output/binary_input.pgm", binary);
 
     savePGM("output/vcs/vcs_share1.pgm", vcs_s1);
     savePGM("output/vcs/vcs_share2.pgm", vcs_s2);
     savePGM("output/vcs/vcs_decrypted.pgm", vcs_dec);
-    std::cout << "Saved VCS files." << std::endl;
-
-    // Run RG
-    std::cout << "\nRunning (2,2) Random Grid Scheme..." << std::endl;
-    Image rg_s1(0, 0), rg_s2(0, 0);
-    RG::generateShares(binary, rg_s1, rg_s2);
-
-    Image rg_dec = RG::decryptShares(rg_s1, rg_s2);
+    if (writePyramids)
+        Pyramid::save("output/vcs/vcs_stack.pyr", vcs_pyr.finish());
+    std::cout << "\nSaved VCS files." << std::endl;
 
     savePGM("output/rg/rg_share1.pgm", rg_s1);
     savePGM("output/rg/rg_share2.pgm", rg_s2);
     savePGM("output/rg/rg_decrypted.pgm", rg_dec);
+    if (writePyramids)
+        Pyramid::save("output/rg/rg_stack.pyr", rg_pyr.finish());
     std::cout << "Saved RG files." << std::endl;
 
-    // Run DHCOD
-    std::cout << "\nRunning DHCOD (Meaningful Shares)..." << std::endl;
-    Image dh_s1(0, 0), dh_s2(0, 0);
-    // DHCOD takes Grayscale input (handles halftoning internally effectively)
-    // or we can pass original input logic.
-    DHCOD::generateShares(input, cover, dh_s1, dh_s2);
-
-    Image dh_dec = DHCOD::decryptShares(dh_s1, dh_s2);
-
     savePGM("output/dhcod/dhcod_share1_meaningful.pgm", dh_s1);
     savePGM("output/dhcod/dhcod_share2_meaningful.pgm", dh_s2);
     savePGM("output/dhcod/dhcod_decrypted.pgm", dh_dec);
+    if (writePyramids)
+        Pyramid::save("output/dhcod/dhcod_stack.pyr", dh_pyr.finish());
     std::cout << "Saved DHCOD files." << std::endl;
 
     std::cout << "\nDone. Check the output PGM files." << std::endl;
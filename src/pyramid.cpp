@@ -0,0 +1,227 @@
+#include "pyramid.hpp"
+#include "scheduler.hpp"
+#include <fstream>
+#include <iostream>
+
+namespace Pyramid {
+
+    static_assert(Scheduler::kTileRows % (1 << kLevels) == 0,
+                  "tiles must not split the largest pyramid block");
+
+    namespace {
+
+        struct Header {
+            int width, height, levels;
+            std::vector<int> w, h;     // indexed by level - 1
+            std::vector<long> offset;  // from the start of the data section
+            std::streamoff dataStart;
+        };
+
+        bool readHeader(std::ifstream& file, Header& hdr) {
+            std::string magic, tag;
+            int version;
+            file >> magic >> version;
+            if (magic != "VCSGPYR" || version != 1) return false;
+
+            file >> hdr.width >> hdr.height >> hdr.levels;
+            if (!file || hdr.width < 1 || hdr.height < 1 || hdr.levels < 1 || hdr.levels > 30) return false;
+            hdr.w.assign(hdr.levels, 0);
+            hdr.h.assign(hdr.levels, 0);
+            hdr.offset.assign(hdr.levels, 0);
+            for (int i = 0; i < hdr.levels; ++i) {
+                int k, w, h;
+                long off;
+                file >> k >> w >> h >> off;
+                if (!file || k < 1 || k > hdr.levels || hdr.w[k - 1] != 0) return false;
+                // A level-k block is 2^k rows high and at least 2^k columns wide
+                if (h != ((hdr.height - 1) >> k) + 1 || w < 1 || w > ((hdr.width - 1) >> k) + 1 || off < 0)
+                    return false;
+                hdr.w[k - 1] = w;
+                hdr.h[k - 1] = h;
+                hdr.offset[k - 1] = off;
+            }
+            file >> tag;
+            if (tag != "DATA") return false;
+            file.get(); // single newline before the raw bytes
+            hdr.dataStart = file.tellg();
+
+            // Every level must lie inside the file (also rules out huge sizes
+            // before anything is allocated for them).
+            file.seekg(0, std::ios::end);
+            long long dataSize = (long long)(file.tellg() - hdr.dataStart);
+            file.seekg(hdr.dataStart);
+            for (int i = 0; i < hdr.levels; ++i) {
+                if (hdr.offset[i] + (long long)hdr.w[i] * hdr.h[i] > dataSize) return false;
+            }
+            return !!file;
+        }
+    }
+
+    Accumulator::Accumulator(int width_, int height_, int xScale)
+        : width(width_), height(height_), xShift(xScale >= 2 ? 1 : 0),
+          level1((width_ + (2 << xShift) - 1) >> (1 + xShift), (height_ + 1) / 2) {}
+
+    void Accumulator::addRow(int r, const int* stacked) {
+        std::vector<int>& out = level1.pixels[r >> 1];
+        int shift = 1 + xShift;
+        for (int c = 0; c < width; ++c) out[c >> shift] += stacked[c];
+    }
+
+    Stack Accumulator::finish() const {
+        int w = width;
+        int h = height;
+
+        Stack stack;
+        stack.width = w;
+        stack.height = h;
+
+        // Black pixel counts per block, per level.
+        std::vector<Image> black(1, level1);
+        for (int k = 2; k <= kLevels; ++k) {
+            const Image& fine = black[k - 2];
+            black.push_back(Image((fine.width + 1) / 2, (fine.height + 1) / 2));
+        }
+
+        // kTileRows is a multiple of the largest block, so tiles never share
+        // a block row and can fill their part of every level independently.
+        Scheduler::parallelRows(h, [&](int r0, int r1) {
+            for (int k = 2; k <= kLevels; ++k) {
+                const Image& fine = black[k - 2];
+                Image& coarse = black[k - 1];
+                int fr1 = (r1 + (1 << (k - 1)) - 1) >> (k - 1);
+                for (int fr = r0 >> (k - 1); fr < fr1; ++fr) {
+                    for (int fc = 0; fc < fine.width; ++fc) {
+                        coarse.pixels[fr >> 1][fc >> 1] += fine.pixels[fr][fc];
+                    }
+                }
+            }
+        });
+
+        // Counts -> grayscale density (border blocks may be partial)
+        for (int k = 1; k <= kLevels; ++k) {
+            int bs = 1 << k;
+            int bsx = bs << xShift;
+            const Image& cnt = black[k - 1];
+            Image level(cnt.width, cnt.height);
+            for (int br = 0; br < cnt.height; ++br) {
+                int bh = (h - br * bs < bs) ? h - br * bs : bs;
+                for (int bc = 0; bc < cnt.width; ++bc) {
+                    int bw = (w - bc * bsx < bsx) ? w - bc * bsx : bsx;
+                    level.pixels[br][bc] = 255 - (255 * cnt.pixels[br][bc]) / (bw * bh);
+                }
+            }
+            stack.levels.push_back(level);
+        }
+        return stack;
+    }
+
+    bool save(const std::string& filename, const Stack& stack) {
+        std::ofstream file(filename, std::ios::binary);
+        if (!file.is_open()) return false;
+
+        int n = (int)stack.levels.size();
+        file << "VCSGPYR 1\n";
+        file << stack.width << " " << stack.height << " " << n << "\n";
+
+        // Coarsest first, so a previewer reads the smallest level soonest.
+        long offset = 0;
+        for (int k = n; k >= 1; --k) {
+            const Image& lv = stack.levels[k - 1];
+            file << k << " " << lv.width << " " << lv.height << " " << offset << "\n";
+            offset += (long)lv.width * lv.height;
+        }
+        file << "DATA\n";
+
+        for (int k = n; k >= 1; --k) {
+            const Image& lv = stack.levels[k - 1];
+            std::vector<char> row(lv.width);
+            for (int r = 0; r < lv.height; ++r) {
+                for (int c = 0; c < lv.width; ++c) row[c] = (char)lv.pixels[r][c];
+                file.write(row.data(), row.size());
+            }
+        }
+        return file.good();
+    }
+
+    Image loadLevel(const std::string& filename, int level) {
+        std::ifstream file(filename, std::ios::binary);
+        if (!file.is_open()) {
+            std::cerr << "Error: Could not open file " << filename << std::endl;
+            return Image(0, 0);
+        }
+
+        Header hdr;
+        if (!readHeader(file, hdr)) {
+            std::cerr << "Error: " << filename << " is not a valid VCSGPYR file" << std::endl;
+            return Image(0, 0);
+        }
+        if (level < 1 || level > hdr.levels) {
+            std::cerr << "Error: " << filename << " has no level " << level << std::endl;
+            return Image(0, 0);
+        }
+
+        // Seek straight to the requested level; the others are never read.
+        int w = hdr.w[level - 1];
+        int h = hdr.h[level - 1];
+        file.seekg(hdr.dataStart + (std::streamoff)hdr.offset[level - 1]);
+
+        Image img(w, h);
+        std::vector<unsigned char> row(w);
+        for (int r = 0; r < h; ++r) {
+            file.read((char*)row.data(), w);
+            for (int c = 0; c < w; ++c) img.pixels[r][c] = row[c];
+        }
+        if (!file) {
+            std::cerr << "Error: " << filename << " is truncated" << std::endl;
+            return Image(0, 0);
+        }
+        return img;
+    }
+
+    int levelCount(const std::string& filename) {
+        std::ifstream file(filename, std::ios::binary);
+        Header hdr;
+        if (!file.is_open() || !readHeader(file, hdr)) return 0;
+        return hdr.levels;
+    }
+
+    Image sampleLevel(const Image& share1, const Image& share2, int level, int xScale, bool useXor) {
+        int w = share1.width;
+        int h = share1.height;
+        int bs = 1 << level;
+        int bsx = (xScale >= 2) ? 2 * bs : bs;
+        Image out((w + bsx - 1) / bsx, (h + bs - 1) / bs);
+
+        Scheduler::parallelRows(out.height, [&](int b0, int b1) {
+            for (int br = b0; br < b1; ++br) {
+                // Middle row of the block row (clamped for a partial last one)
+                int r = br * bs + bs / 2;
+                if (r >= h) r = h - 1;
+                const std::vector<int>& a = share1.pixels[r];
+                const std::vector<int>& b = share2.pixels[r];
+                for (int bc = 0; bc < out.width; ++bc) {
+                    int c0 = bc * bsx;
+                    int c1 = (c0 + bsx < w) ? c0 + bsx : w;
+                    int black = 0;
+                    for (int c = c0; c < c1; ++c) black += useXor ? (a[c] ^ b[c]) : (a[c] | b[c]);
+                    out.pixels[br][bc] = 255 - (255 * black) / (c1 - c0);
+                }
+            }
+        });
+        return out;
+    }
+
+    bool savePreview(const std::string& filename, const Image& level) {
+        std::ofstream file(filename, std::ios::binary);
+        if (!file.is_open()) return false;
+
+        file << "P5\n" << level.width << " " << level.height << "\n255\n";
+        std::vector<char> row(level.width);
+        for (int r = 0; r < level.height; ++r) {
+            for (int c = 0; c < level.width; ++c) row[c] = (char)level.pixels[r][c];
+            file.write(row.data(), row.size());
+        }
+        return file.good();
+    }
+
+}
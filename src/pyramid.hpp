@@ -0,0 +1,68 @@
+#ifndef PYRAMID_HPP
+#define PYRAMID_HPP
+
+#include "image_utils.hpp"
+#include <vector>
+
+namespace Pyramid {
+    // Multi-resolution preview of a stacked share pair.
+    // Level k (1..kLevels) covers blocks of (xScale * 2^k) x 2^k stack pixels
+    // (1/4, 1/16, 1/64 of the secret's pixel count) and stores the stack's
+    // density as a grayscale value: 0 = all black, 255 = all white (PGM
+    // convention). xScale is the horizontal pixel expansion (2 for VCS), so
+    // previews keep the secret's aspect ratio.
+    //
+    // A level IS the secret, downscaled: whoever holds a .pyr file (or a
+    // preview PGM) can read the secret without either share. The tools only
+    // write .pyr files on request (--pyramid); sampleLevel() builds previews
+    // on the decrypt side from the two shares instead.
+    const int kLevels = 3;
+
+    struct Stack {
+        int width;                 // full-resolution stack size
+        int height;
+        std::vector<Image> levels; // levels[k - 1] is level k
+    };
+
+    // Collects level 1 while the stack is being decrypted, so building the
+    // pyramid needs no extra pass over the shares.
+    // addRow() may be called from several tiles at once: Scheduler tiles
+    // never share a block row.
+    class Accumulator {
+    public:
+        Accumulator(int width, int height, int xScale = 1);
+
+        // Row r of the decrypted stack (1 = Black, 0 = White).
+        void addRow(int r, const int* stacked);
+
+        // Coarser levels from level 1 and conversion to grayscale.
+        Stack finish() const;
+
+    private:
+        int width, height;
+        int xShift;    // log2(xScale)
+        Image level1;  // black pixel counts per level-1 block
+    };
+
+    // .pyr file: text header with one line per level (size + byte offset),
+    // then the raw level bytes, coarsest level first.
+    bool save(const std::string& filename, const Stack& stack);
+
+    // Read just one level from a .pyr file. Returns an empty image on failure.
+    Image loadLevel(const std::string& filename, int level);
+
+    // Number of levels stored in a .pyr file (0 on failure).
+    int levelCount(const std::string& filename);
+
+    // Level k estimated straight from the two shares, for a progressive
+    // preview on the decrypt side: only one row per block row is stacked
+    // (1/2^k of the image), so the coarsest level costs 1/8 of a decrypt and
+    // each finer level sharpens the previous one. useXor selects the DHCOD
+    // (digital) stack instead of OR.
+    Image sampleLevel(const Image& share1, const Image& share2, int level, int xScale, bool useXor);
+
+    // Write a level as a P5 PGM (values are already 0-255 grayscale).
+    bool savePreview(const std::string& filename, const Image& level);
+}
+
+#endif // PYRAMID_HPP
@@ -0,0 +1,196 @@
+#include "resample.hpp"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace Resample {
+
+    namespace {
+
+        // Centre-aligned source position of output index i, in 1/256 pixels.
+        // Equal sizes map i -> i exactly, so a matching cover is unchanged.
+        long long sourcePos256(int i, int outSize, int srcSize) {
+            long long pos = ((2LL * i + 1) * srcSize * 256) / (2LL * outSize) - 128;
+            return pos < 0 ? 0 : pos;
+        }
+
+        int nearestIndex(int i, int outSize, int srcSize) {
+            long long s = ((2LL * i + 1) * srcSize) / (2LL * outSize);
+            return (int)(s < srcSize ? s : srcSize - 1);
+        }
+
+        // Vertical passes over whole rows, 4 (int) or 16 (8-bit) pixels per
+        // step with SSE2. GCC's -O2 cost model won't vectorise the plain
+        // loops (they need a scalar tail), so this is done by hand, as in
+        // vcs.cpp. Results are identical to the scalar loops.
+#ifdef __SSE2__
+        // SSE2 has no 32-bit mullo: multiply the even and odd lanes apart.
+        inline __m128i mulLo32(__m128i a, __m128i b) {
+            __m128i even = _mm_mul_epu32(a, b);
+            __m128i odd = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+            return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                                      _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+        }
+
+        // 8 unsigned 16-bit lanes widened to ints and stored to / added to v[0..7]
+        inline void storeWide(int* v, __m128i x16) {
+            const __m128i zero = _mm_setzero_si128();
+            _mm_storeu_si128((__m128i*)v, _mm_unpacklo_epi16(x16, zero));
+            _mm_storeu_si128((__m128i*)(v + 4), _mm_unpackhi_epi16(x16, zero));
+        }
+
+        inline void addWide(int* v, __m128i x16) {
+            const __m128i zero = _mm_setzero_si128();
+            __m128i* p = (__m128i*)v;
+            _mm_storeu_si128(p, _mm_add_epi32(_mm_loadu_si128(p), _mm_unpacklo_epi16(x16, zero)));
+            _mm_storeu_si128(p + 1, _mm_add_epi32(_mm_loadu_si128(p + 1), _mm_unpackhi_epi16(x16, zero)));
+        }
+#endif
+
+        void blendRows(const int* a, const int* b, int fy, int n, int* v) {
+            int x = 0;
+#ifdef __SSE2__
+            __m128i wa = _mm_set1_epi32(256 - fy);
+            __m128i wb = _mm_set1_epi32(fy);
+            for (; x + 4 <= n; x += 4) {
+                __m128i pa = _mm_loadu_si128((const __m128i*)(a + x));
+                __m128i pb = _mm_loadu_si128((const __m128i*)(b + x));
+                _mm_storeu_si128((__m128i*)(v + x), _mm_add_epi32(mulLo32(pa, wa), mulLo32(pb, wb)));
+            }
+#endif
+            for (; x < n; ++x) v[x] = a[x] * (256 - fy) + b[x] * fy;
+        }
+
+        void blendRows(const unsigned char* a, const unsigned char* b, int fy, int n, int* v) {
+            int x = 0;
+#ifdef __SSE2__
+            // a * (256 - fy) + b * fy <= 255 * 256, so 16-bit lanes suffice
+            const __m128i zero = _mm_setzero_si128();
+            __m128i wa = _mm_set1_epi16((short)(256 - fy));
+            __m128i wb = _mm_set1_epi16((short)fy);
+            for (; x + 16 <= n; x += 16) {
+                __m128i pa = _mm_loadu_si128((const __m128i*)(a + x));
+                __m128i pb = _mm_loadu_si128((const __m128i*)(b + x));
+                storeWide(v + x, _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(pa, zero), wa),
+                                               _mm_mullo_epi16(_mm_unpacklo_epi8(pb, zero), wb)));
+                storeWide(v + x + 8, _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(pa, zero), wa),
+                                                   _mm_mullo_epi16(_mm_unpackhi_epi8(pb, zero), wb)));
+            }
+#endif
+            for (; x < n; ++x) v[x] = a[x] * (256 - fy) + b[x] * fy;
+        }
+
+        void addRow(const int* in, int n, int* v) {
+            int x = 0;
+#ifdef __SSE2__
+            for (; x + 4 <= n; x += 4) {
+                __m128i* p = (__m128i*)(v + x);
+                _mm_storeu_si128(p, _mm_add_epi32(_mm_loadu_si128(p), _mm_loadu_si128((const __m128i*)(in + x))));
+            }
+#endif
+            for (; x < n; ++x) v[x] += in[x];
+        }
+
+        void addRow(const unsigned char* in, int n, int* v) {
+            int x = 0;
+#ifdef __SSE2__
+            const __m128i zero = _mm_setzero_si128();
+            for (; x + 16 <= n; x += 16) {
+                __m128i p = _mm_loadu_si128((const __m128i*)(in + x));
+                addWide(v + x, _mm_unpacklo_epi8(p, zero));
+                addWide(v + x + 8, _mm_unpackhi_epi8(p, zero));
+            }
+#endif
+            for (; x < n; ++x) v[x] += in[x];
+        }
+    }
+
+    std::vector<const int*> rowPointers(const Image& img) {
+        std::vector<const int*> rows(img.height);
+        for (int r = 0; r < img.height; ++r) rows[r] = img.pixels[r].data();
+        return rows;
+    }
+
+    template <typename Pixel>
+    RowSampler<Pixel>::RowSampler(const std::vector<const Pixel*>& rows, int srcW_, int outW_, int outH_,
+                                  Filter filter_, Fit fit_)
+        : src(rows), srcW(srcW_), outW(outW_), outH(outH_), filter(filter_), fit(fit_),
+          colStart(outW_), colParam(outW_, 0) {
+        int sw = srcW;
+        for (int x = 0; x < outW; ++x) {
+            if (fit == TILE) {
+                colStart[x] = x % sw;
+            } else if (filter == NEAREST) {
+                colStart[x] = nearestIndex(x, outW, sw);
+            } else if (filter == BILINEAR) {
+                long long pos = sourcePos256(x, outW, sw);
+                int x0 = (int)(pos >> 8);
+                int fx = (int)(pos & 255);
+                if (x0 >= sw - 1) { x0 = sw - 1; fx = 0; }
+                colStart[x] = x0;
+                colParam[x] = fx;
+            } else { // AREA
+                int s = (int)(((long long)x * sw) / outW);
+                int e = (int)(((long long)(x + 1) * sw + outW - 1) / outW);
+                colStart[x] = s;
+                colParam[x] = (e > s) ? e : s + 1;
+            }
+        }
+    }
+
+    template <typename Pixel>
+    void RowSampler<Pixel>::row(int y, int* out, std::vector<int>& scratch) const {
+        int sw = srcW;
+        int sh = (int)src.size();
+
+        if (fit == TILE || filter == NEAREST) {
+            int sy = (fit == TILE) ? y % sh : nearestIndex(y, outH, sh);
+            const Pixel* in = src[sy];
+            for (int x = 0; x < outW; ++x) out[x] = in[colStart[x]];
+            return;
+        }
+
+        if (filter == BILINEAR) {
+            long long pos = sourcePos256(y, outH, sh);
+            int y0 = (int)(pos >> 8);
+            int fy = (int)(pos & 255);
+            if (y0 >= sh - 1) { y0 = sh - 1; fy = 0; }
+            const Pixel* a = src[y0];
+            const Pixel* b = src[(fy > 0) ? y0 + 1 : y0];
+
+            // Vertical blend over whole contiguous rows (SSE2), with one
+            // duplicated column at the end so x0 + 1 is always readable.
+            scratch.resize(sw + 1);
+            int* v = &scratch[0];
+            blendRows(a, b, fy, sw, v);
+            v[sw] = v[sw - 1];
+
+            for (int x = 0; x < outW; ++x) {
+                int x0 = colStart[x];
+                int fx = colParam[x];
+                out[x] = (v[x0] * (256 - fx) + v[x0 + 1] * fx + (1 << 15)) >> 16;
+            }
+            return;
+        }
+
+        // AREA: sum the covered source rows, then average each column span.
+        int ys = (int)(((long long)y * sh) / outH);
+        int ye = (int)(((long long)(y + 1) * sh + outH - 1) / outH);
+        if (ye <= ys) ye = ys + 1;
+
+        scratch.assign(sw, 0);
+        int* v = &scratch[0];
+        for (int sy = ys; sy < ye; ++sy) addRow(src[sy], sw, v);
+        for (int x = 0; x < outW; ++x) {
+            long long sum = 0;
+            for (int sx = colStart[x]; sx < colParam[x]; ++sx) sum += v[sx];
+            long long n = (long long)(colParam[x] - colStart[x]) * (ye - ys);
+            out[x] = (int)((sum + n / 2) / n);
+        }
+    }
+
+    template class RowSampler<int>;
+    template class RowSampler<unsigned char>;
+
+}
@@ -0,0 +1,52 @@
+#ifndef RESAMPLE_HPP
+#define RESAMPLE_HPP
+
+#include "image_utils.hpp"
+#include <vector>
+
+namespace Resample {
+    enum Filter {
+        NEAREST,
+        BILINEAR,
+        AREA      // box average over the covered source pixels (for shrinking)
+    };
+
+    enum Fit {
+        STRETCH,  // scale the source to exactly outW x outH
+        TILE      // repeat the source at its own size (filter unused)
+    };
+
+    // Streams the rows of a source image resized to outW x outH, one row at
+    // a time, so the full-size result never exists in memory.
+    // The source is given as row pointers (an Image's rows, or rows of a
+    // caller's strided 8-bit buffer), so it is never copied either.
+    // Column positions/weights are worked out once up front; row() only does
+    // a vertical blend over contiguous rows and an indexed horizontal pass.
+    // row() is const and can be called from several tiles at once.
+    // Instantiated for int and unsigned char pixels.
+    template <typename Pixel>
+    class RowSampler {
+    public:
+        RowSampler(const std::vector<const Pixel*>& rows, int srcW, int outW, int outH, Filter filter, Fit fit);
+
+        // Write output row y (outW values) to out.
+        // scratch is a per-caller buffer, reused between calls.
+        void row(int y, int* out, std::vector<int>& scratch) const;
+
+    private:
+        std::vector<const Pixel*> src;
+        int srcW, outW, outH;
+        Filter filter;
+        Fit fit;
+
+        // Per output column: first source column and (bilinear) weight of
+        // the next one in 1/256ths, or (area) one-past-last source column.
+        std::vector<int> colStart;
+        std::vector<int> colParam;
+    };
+
+    // Row pointers of an Image, for RowSampler<int>.
+    std::vector<const int*> rowPointers(const Image& img);
+}
+
+#endif // RESAMPLE_HPP
@@ -1,45 +1,74 @@
 #include "rg.hpp"
-#include <cstdlib>
+#include "scheduler.hpp"
+#include <random>
 
 namespace RG {
 
     void generateShares(const Image& secret, Image& share1, Image& share2) {
+        Scheduler::waitAll(submitGenerate(secret, share1, share2));
+    }
+
+    std::vector<Scheduler::Task> submitGenerate(const Image& secret, Image& share1, Image& share2,
+                                                const std::vector<Scheduler::Task>& after) {
         int w = secret.width;
         int h = secret.height;
 
         share1 = Image(w, h);
         share2 = Image(w, h);
 
-        for (int r = 0; r < h; ++r) {
-            for (int c = 0; c < w; ++c) {
-                // Step 1: Randomize R1
-                share1.pixels[r][c] = rand() % 2; // 0 or 1
+        // One generator per tile, keyed from rand() (see VCS::generateShares).
+        std::vector<unsigned> key = Scheduler::randKey();
 
-                // Step 2: Determine R2 based on Secret Pixel
-                // Secret: 0=White, 1=Black
-                int secretPixel = secret.pixels[r][c];
-
-                if (secretPixel == 0) { // White
-                    share2.pixels[r][c] = share1.pixels[r][c];
-                } else { // Black
-                    share2.pixels[r][c] = 1 - share1.pixels[r][c];
-                }
+        return Scheduler::submitRows(h, [&secret, &share1, &share2, key, w](int r0, int r1) {
+            std::mt19937 rng = Scheduler::tileRng(key, r0 / Scheduler::kTileRows);
+            for (int r = r0; r < r1; ++r) {
+                if (w == 0) continue;
+                // Secret: 0=White, 1=Black, i.e. black = !(pixel < 1)
+                encodeRow(&secret.pixels[r][0], w, 1, true, rng, &share1.pixels[r][0], &share2.pixels[r][0]);
             }
+        }, after);
+    }
+
+    template <typename In, typename Out>
+    void encodeRow(const In* px, int w, int threshold, bool invert, std::mt19937& rng, Out* s1, Out* s2) {
+        for (int c = 0; c < w; ++c) {
+            // Step 1: Randomize R1
+            int r1 = rng() % 2; // 0 or 1
+            s1[c] = r1;
+
+            // Step 2: Determine R2 based on Secret Pixel
+            // White -> R2 = R1, Black -> R2 = NOT R1
+            int black = ((px[c] < threshold) != invert) ? 1 : 0;
+            s2[c] = black ? 1 - r1 : r1;
         }
     }
 
-    Image decryptShares(const Image& share1, const Image& share2) {
+    template void encodeRow<int, int>(const int*, int, int, bool, std::mt19937&, int*, int*);
+    template void encodeRow<unsigned char, unsigned char>(const unsigned char*, int, int, bool, std::mt19937&,
+                                                          unsigned char*, unsigned char*);
+
+    Image decryptShares(const Image& share1, const Image& share2, Pyramid::Accumulator* pyramid) {
+        Image result(0, 0);
+        Scheduler::waitAll(submitDecrypt(share1, share2, result, pyramid));
+        return result;
+    }
+
+    std::vector<Scheduler::Task> submitDecrypt(const Image& share1, const Image& share2, Image& result,
+                                               Pyramid::Accumulator* pyramid,
+                                               const std::vector<Scheduler::Task>& after) {
         int w = share1.width;
         int h = share1.height;
-        Image result(w, h);
+        result = Image(w, h);
 
-        for (int r = 0; r < h; ++r) {
-            for (int c = 0; c < w; ++c) {
-                // Visual decryption is superposition (OR)
-                result.pixels[r][c] = share1.pixels[r][c] | share2.pixels[r][c];
+        return Scheduler::submitRows(h, [&share1, &share2, &result, pyramid, w](int r0, int r1) {
+            for (int r = r0; r < r1; ++r) {
+                for (int c = 0; c < w; ++c) {
+                    // Visual decryption is superposition (OR)
+                    result.pixels[r][c] = share1.pixels[r][c] | share2.pixels[r][c];
+                }
+                if (pyramid) pyramid->addRow(r, &result.pixels[r][0]);
             }
-        }
-        return result;
+        }, after);
     }
 
 }
@@ -2,6 +2,9 @@
 #define RG_HPP
 
 #include "image_utils.hpp"
+#include "pyramid.hpp"
+#include "scheduler.hpp"
+#include <random>
 
 namespace RG {
     // Generate (2,2) shares using Kafri-Keren Random Grid scheme.
@@ -10,7 +13,20 @@ namespace RG {
     void generateShares(const Image& secret, Image& share1, Image& share2);
 
     // Simulate visual decryption (OR).
-    Image decryptShares(const Image& share1, const Image& share2);
+    // pyramid (optional) collects the stack preview in the same pass.
+    Image decryptShares(const Image& share1, const Image& share2, Pyramid::Accumulator* pyramid = 0);
+
+    // Tile-task forms for pipelining (see VCS::submitGenerateFromGray).
+    std::vector<Scheduler::Task> submitGenerate(const Image& secret, Image& share1, Image& share2,
+                                                const std::vector<Scheduler::Task>& after = std::vector<Scheduler::Task>());
+    std::vector<Scheduler::Task> submitDecrypt(const Image& share1, const Image& share2, Image& result,
+                                               Pyramid::Accumulator* pyramid = 0,
+                                               const std::vector<Scheduler::Task>& after = std::vector<Scheduler::Task>());
+
+    // Row kernel (int and unsigned char pixels; used by the C API on raw
+    // buffers). A pixel is black when (pixel < threshold) != invert.
+    template <typename In, typename Out>
+    void encodeRow(const In* px, int w, int threshold, bool invert, std::mt19937& rng, Out* s1, Out* s2);
 }
 
 #endif // RG_HPP
@@ -0,0 +1,314 @@
+#include "scheduler.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace Scheduler {
+
+    struct TaskNode {
+        std::function<void()> fn;
+        std::atomic<int> pending;    // unfinished dependencies (+1 while being set up)
+        std::mutex mtx;              // guards done / dependents / error
+        bool done;
+        std::vector<Task> dependents;
+        std::exception_ptr error;    // thrown by fn, or inherited from a failed dependency
+
+        TaskNode() : pending(1), done(false) {}
+    };
+
+    namespace {
+
+        // One per worker. The owner works at the back, thieves take the front.
+        struct WorkerQueue {
+            std::mutex mtx;
+            std::deque<Task> tasks;
+        };
+
+        std::mutex g_poolMutex;               // guards pool start/stop
+        std::vector<std::thread> g_threads;
+        std::vector<WorkerQueue*> g_queues;
+        int g_threadCount = 0;                // 0 = not started yet
+        std::atomic<bool> g_stop(false);
+        std::atomic<unsigned> g_nextQueue(0);
+
+        std::atomic<int> g_queued(0);         // tasks sitting in any deque
+        std::mutex g_sleepMutex;
+        std::condition_variable g_sleepCv;    // workers waiting for work
+        std::condition_variable g_doneCv;     // waiters waiting for a task to finish
+
+        // Index of the current thread's own queue, -1 for non-worker threads.
+        thread_local int t_workerIndex = -1;
+
+        // Set by InlineScope: submit() runs ready tasks on the spot.
+        thread_local bool t_inline = false;
+
+        int defaultThreadCount() {
+            const char* env = std::getenv("VC_THREADS");
+            if (env) {
+                int n = std::atoi(env);
+                if (n > 0) return n;
+            }
+            int hw = (int)std::thread::hardware_concurrency();
+            return (hw > 0) ? hw : 1;
+        }
+
+        void push(const Task& task) {
+            int n = (int)g_queues.size();
+            int idx = (t_workerIndex >= 0) ? t_workerIndex : (int)(g_nextQueue++ % n);
+            {
+                std::lock_guard<std::mutex> lock(g_queues[idx]->mtx);
+                g_queues[idx]->tasks.push_back(task);
+            }
+            g_queued++;
+            std::lock_guard<std::mutex> lock(g_sleepMutex);
+            g_sleepCv.notify_one();
+        }
+
+        // Pop from our own queue first, then try to steal from the others.
+        Task take() {
+            int n = (int)g_queues.size();
+            if (t_workerIndex >= 0) {
+                WorkerQueue* q = g_queues[t_workerIndex];
+                std::lock_guard<std::mutex> lock(q->mtx);
+                if (!q->tasks.empty()) {
+                    Task t = q->tasks.back();
+                    q->tasks.pop_back();
+                    g_queued--;
+                    return t;
+                }
+            }
+            int start = (t_workerIndex >= 0) ? t_workerIndex + 1 : 0;
+            for (int i = 0; i < n; ++i) {
+                WorkerQueue* q = g_queues[(start + i) % n];
+                std::lock_guard<std::mutex> lock(q->mtx);
+                if (!q->tasks.empty()) {
+                    Task t = q->tasks.front();
+                    q->tasks.pop_front();
+                    g_queued--;
+                    return t;
+                }
+            }
+            return Task();
+        }
+
+        // Runs fn and always marks the task done, even if fn throws: the
+        // exception is kept for wait() and dependents are released (they
+        // inherit it and are skipped, since their input is incomplete).
+        void run(const Task& task) {
+            std::exception_ptr error;
+            {
+                std::lock_guard<std::mutex> lock(task->mtx);
+                error = task->error;
+            }
+            if (!error) {
+                try {
+                    task->fn();
+                } catch (...) {
+                    error = std::current_exception();
+                }
+            }
+            task->fn = std::function<void()>(); // release captures early
+
+            std::vector<Task> ready;
+            {
+                std::lock_guard<std::mutex> lock(task->mtx);
+                task->done = true;
+                task->error = error;
+                ready.swap(task->dependents);
+            }
+            for (size_t i = 0; i < ready.size(); ++i) {
+                if (error) {
+                    std::lock_guard<std::mutex> lock(ready[i]->mtx);
+                    if (!ready[i]->error) ready[i]->error = error;
+                }
+                if (--ready[i]->pending == 0) push(ready[i]);
+            }
+            std::lock_guard<std::mutex> lock(g_sleepMutex);
+            g_doneCv.notify_all();
+        }
+
+        void workerLoop(int index) {
+            t_workerIndex = index;
+            while (!g_stop) {
+                Task task = take();
+                if (task) {
+                    run(task);
+                    continue;
+                }
+                std::unique_lock<std::mutex> lock(g_sleepMutex);
+                g_sleepCv.wait(lock, [] { return g_stop || g_queued > 0; });
+            }
+        }
+
+        void stopPool() {
+            {
+                std::lock_guard<std::mutex> lock(g_sleepMutex);
+                g_stop = true;
+                g_sleepCv.notify_all();
+            }
+            for (size_t i = 0; i < g_threads.size(); ++i) g_threads[i].join();
+            for (size_t i = 0; i < g_queues.size(); ++i) delete g_queues[i];
+            g_threads.clear();
+            g_queues.clear();
+            g_stop = false;
+        }
+
+        // If a thread cannot be created, runs with the ones that were (every
+        // worker steals from all n queues); with none, throws system_error
+        // and leaves the pool unstarted.
+        void startPool(int n) {
+            for (int i = 0; i < n; ++i) g_queues.push_back(new WorkerQueue());
+            try {
+                g_threads.reserve(n); // so push_back cannot drop a running thread
+                for (int i = 0; i < n; ++i) g_threads.push_back(std::thread(workerLoop, i));
+            } catch (...) {
+                if (g_threads.empty()) {
+                    for (size_t i = 0; i < g_queues.size(); ++i) delete g_queues[i];
+                    g_queues.clear();
+                    g_threadCount = 0;
+                    throw;
+                }
+            }
+            g_threadCount = (int)g_threads.size();
+        }
+
+        // Joins the workers at exit so they don't outlive the statics they use.
+        struct PoolGuard {
+            ~PoolGuard() {
+                std::lock_guard<std::mutex> lock(g_poolMutex);
+                if (g_threadCount > 0) stopPool();
+            }
+        } g_poolGuard;
+
+        void ensureStarted() {
+            std::lock_guard<std::mutex> lock(g_poolMutex);
+            if (g_threadCount == 0) startPool(defaultThreadCount());
+        }
+    }
+
+    void setThreadCount(int n) {
+        if (n < 1) n = 1;
+        std::lock_guard<std::mutex> lock(g_poolMutex);
+        if (n == g_threadCount) return;
+        if (g_threadCount > 0) stopPool();
+        startPool(n);
+    }
+
+    int threadCount() {
+        ensureStarted();
+        return g_threadCount;
+    }
+
+    Task submit(const std::function<void()>& fn, const std::vector<Task>& deps) {
+        ensureStarted();
+        Task task = std::make_shared<TaskNode>();
+        task->fn = fn;
+
+        for (size_t i = 0; i < deps.size(); ++i) {
+            if (!deps[i]) continue;
+            std::lock_guard<std::mutex> lock(deps[i]->mtx);
+            if (!deps[i]->done) {
+                task->pending++;
+                deps[i]->dependents.push_back(task);
+            } else if (deps[i]->error) {
+                // Already published to earlier dependencies, which may fail concurrently
+                std::lock_guard<std::mutex> taskLock(task->mtx);
+                if (!task->error) task->error = deps[i]->error;
+            }
+        }
+        // Drop the setup reference; if every dependency already finished
+        // the task is ready right away.
+        if (--task->pending == 0) {
+            if (t_inline) run(task);
+            else push(task);
+        }
+        return task;
+    }
+
+    InlineScope::InlineScope() : outer(t_inline) {
+        t_inline = true;
+    }
+
+    InlineScope::~InlineScope() {
+        t_inline = outer;
+    }
+
+    namespace {
+
+        // wait() without the rethrow; returns the task's exception, if any.
+        std::exception_ptr finish(const Task& task) {
+            if (!task) return std::exception_ptr();
+            while (true) {
+                {
+                    std::lock_guard<std::mutex> lock(task->mtx);
+                    if (task->done) return task->error;
+                }
+                // Help out instead of blocking a thread the pool may need.
+                Task other = take();
+                if (other) {
+                    run(other);
+                    continue;
+                }
+                std::unique_lock<std::mutex> lock(g_sleepMutex);
+                g_doneCv.wait_for(lock, std::chrono::milliseconds(1));
+            }
+        }
+    }
+
+    void wait(const Task& task) {
+        std::exception_ptr error = finish(task);
+        if (error) std::rethrow_exception(error);
+    }
+
+    void waitAll(const std::vector<Task>& tasks) {
+        // Every task must be finished before throwing: tiles usually capture
+        // the caller's locals by reference.
+        std::exception_ptr first;
+        for (size_t i = 0; i < tasks.size(); ++i) {
+            std::exception_ptr error = finish(tasks[i]);
+            if (error && !first) first = error;
+        }
+        if (first) std::rethrow_exception(first);
+    }
+
+    int tileCount(int rows) {
+        return (rows + kTileRows - 1) / kTileRows;
+    }
+
+    std::vector<unsigned> randKey() {
+        std::vector<unsigned> key(4);
+        for (size_t i = 0; i < key.size(); ++i) key[i] = (unsigned)rand();
+        return key;
+    }
+
+    std::mt19937 tileRng(const std::vector<unsigned>& key, int tile) {
+        std::vector<unsigned> words(key);
+        words.push_back((unsigned)tile);
+        std::seed_seq seq(words.begin(), words.end());
+        return std::mt19937(seq);
+    }
+
+    std::vector<Task> submitRows(int rows, const std::function<void(int, int)>& fn,
+                                 const std::vector<Task>& tileDeps) {
+        int tiles = tileCount(rows);
+        std::vector<Task> tasks(tiles);
+        for (int t = 0; t < tiles; ++t) {
+            int r0 = t * kTileRows;
+            int r1 = (r0 + kTileRows < rows) ? r0 + kTileRows : rows;
+            std::vector<Task> deps;
+            if (t < (int)tileDeps.size()) deps.push_back(tileDeps[t]);
+            tasks[t] = submit([fn, r0, r1] { fn(r0, r1); }, deps);
+        }
+        return tasks;
+    }
+
+    void parallelRows(int rows, const std::function<void(int, int)>& fn) {
+        waitAll(submitRows(rows, fn));
+    }
+
+}
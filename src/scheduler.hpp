@@ -0,0 +1,78 @@
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+
+#include <functional>
+#include <memory>
+#include <random>
+#include <vector>
+
+// Shared work-stealing task scheduler used by every stage (image utils,
+// VCS/RG/DHCOD and the analysis metrics).
+// Each worker thread owns a deque: it pushes/pops its own work at the back
+// and idle workers steal from the front of the others.
+// Tasks may depend on other tasks, so a stage can start on a tile as soon as
+// the tiles it reads are finished instead of waiting for the whole image.
+namespace Scheduler {
+
+    struct TaskNode;
+    typedef std::shared_ptr<TaskNode> Task;
+
+    // Images are split into horizontal tiles of this many rows.
+    // All stages use the same tiling so tile i of one stage lines up with
+    // tile i of the next one.
+    const int kTileRows = 32;
+
+    // Number of worker threads. Defaults to the VC_THREADS environment
+    // variable, or the hardware concurrency if that is not set.
+    // Call setThreadCount() before submitting work (or while idle).
+    void setThreadCount(int n);
+    int threadCount();
+
+    // Queue fn to run once every task in deps has finished.
+    Task submit(const std::function<void()>& fn, const std::vector<Task>& deps = std::vector<Task>());
+
+    // Block until the task(s) finished. The calling thread runs queued
+    // tasks while it waits, so waiting from inside a task is fine.
+    // If a task threw (or one of its dependencies did, in which case it is
+    // skipped), the exception is rethrown here; waitAll() still waits for
+    // every task first and rethrows the first one.
+    void wait(const Task& task);
+    void waitAll(const std::vector<Task>& tasks);
+
+    // While an InlineScope lives on a thread, the tasks that thread submits
+    // run right away, in order, on that thread (they come back finished).
+    // A task that runs a whole small job in one go uses it, so it never
+    // waits inside the pool and never runs unrelated tasks in its frame.
+    class InlineScope {
+    public:
+        InlineScope();
+        ~InlineScope();
+
+    private:
+        bool outer;
+        InlineScope(const InlineScope&);
+        InlineScope& operator=(const InlineScope&);
+    };
+
+    // Number of kTileRows tiles covering 'rows' rows.
+    int tileCount(int rows);
+
+    // Random key for tileRng, drawn from rand() so srand() keeps
+    // controlling the tools.
+    std::vector<unsigned> randKey();
+
+    // Generator for one tile, seeded with the seed_seq (key..., tile).
+    // Tiles of an image never share a coin stream, unlike seeding each from
+    // one rand() value (RAND_MAX is 32767 on Windows).
+    std::mt19937 tileRng(const std::vector<unsigned>& key, int tile);
+
+    // Submit fn(rowBegin, rowEnd) once per tile. If tileDeps is given,
+    // tile i waits for tileDeps[i] (e.g. the same tile of a previous stage).
+    std::vector<Task> submitRows(int rows, const std::function<void(int, int)>& fn,
+                                 const std::vector<Task>& tileDeps = std::vector<Task>());
+
+    // Submit the tiles and wait for all of them.
+    void parallelRows(int rows, const std::function<void(int, int)>& fn);
+}
+
+#endif // SCHEDULER_HPP
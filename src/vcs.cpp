@@ -1,69 +1,194 @@
 #include "vcs.hpp"
-#include <cstdlib>
+#include "scheduler.hpp"
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 namespace VCS {
 
-    void generateShares(const Image& secret, Image& share1, Image& share2) {
-        int w = secret.width;
-        int h = secret.height;
-
-        // Expansion factor: 2 (horizontal)
-        share1 = Image(w * 2, h);
-        share2 = Image(w * 2, h);
-
-        for (int r = 0; r < h; ++r) {
-            for (int c = 0; c < w; ++c) {
-                int pixel = secret.pixels[r][c]; // 0=White, 1=Black
-
-                // Base patterns
-                // 0: [1, 0] (Black, White)
-                // 1: [0, 1] (White, Black)
-                
-                int coin = rand() % 2; 
-                int s1_sub[2];
-                int s2_sub[2];
-
-                if (pixel == 0) { // White Pixel -> Shares should be identical
-                    if (coin == 0) {
-                        s1_sub[0] = 1; s1_sub[1] = 0;
-                        s2_sub[0] = 1; s2_sub[1] = 0;
-                    } else {
-                        s1_sub[0] = 0; s1_sub[1] = 1;
-                        s2_sub[0] = 0; s2_sub[1] = 1;
-                    }
-                } else { // Black Pixel -> Shares should be complements
-                    if (coin == 0) {
-                        s1_sub[0] = 1; s1_sub[1] = 0;
-                        s2_sub[0] = 0; s2_sub[1] = 1;
-                    } else {
-                        s1_sub[0] = 0; s1_sub[1] = 1;
-                        s2_sub[0] = 1; s2_sub[1] = 0;
+    namespace {
+
+        // pairs[b] holds the 16 subpixels for 8 pixels whose coins are the
+        // bits of b (bit 0 = first pixel).
+        // Coin 0 -> [1, 0] (Black, White), Coin 1 -> [0, 1] (White, Black).
+        // Share1 uses the coins as is. Share2 uses coins ^ secret, i.e. the
+        // same pattern for a white pixel and the complement for a black one.
+        template <typename T>
+        struct PairTable {
+            T pairs[256][16];
+            PairTable() {
+                for (int b = 0; b < 256; ++b) {
+                    for (int i = 0; i < 8; ++i) {
+                        int coin = (b >> i) & 1;
+                        pairs[b][2 * i] = coin ? 0 : 1;
+                        pairs[b][2 * i + 1] = coin ? 1 : 0;
                     }
                 }
+            }
+        };
+        const PairTable<int> kTable;
+        const PairTable<unsigned char> kTable8;
 
-                share1.pixels[r][2 * c] = s1_sub[0];
-                share1.pixels[r][2 * c + 1] = s1_sub[1];
+        // Table matching the output pixel type
+        typedef int IntPairs[256][16];
+        typedef unsigned char BytePairs[256][16];
+        inline const IntPairs& pairsFor(const int*) { return kTable.pairs; }
+        inline const BytePairs& pairsFor(const unsigned char*) { return kTable8.pairs; }
 
-                share2.pixels[r][2 * c] = s2_sub[0];
-                share2.pixels[r][2 * c + 1] = s2_sub[1];
-            }
+        // Bit i set if px[i] < threshold, for 16 pixels.
+        inline unsigned lessMask16(const int* px, int threshold) {
+#ifdef __SSE2__
+            __m128i t = _mm_set1_epi32(threshold);
+            __m128i a = _mm_cmplt_epi32(_mm_loadu_si128((const __m128i*)(px + 0)), t);
+            __m128i b = _mm_cmplt_epi32(_mm_loadu_si128((const __m128i*)(px + 4)), t);
+            __m128i c = _mm_cmplt_epi32(_mm_loadu_si128((const __m128i*)(px + 8)), t);
+            __m128i d = _mm_cmplt_epi32(_mm_loadu_si128((const __m128i*)(px + 12)), t);
+            // 4x4 int masks -> 16 byte masks -> one bit per pixel
+            __m128i bytes = _mm_packs_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+            return (unsigned)_mm_movemask_epi8(bytes);
+#else
+            unsigned m = 0;
+            for (int i = 0; i < 16; ++i) m |= (unsigned)(px[i] < threshold) << i;
+            return m;
+#endif
+        }
+
+        inline unsigned lessMask16(const unsigned char* px, int threshold) {
+            if (threshold <= 0) return 0;
+            if (threshold > 255) return 0xFFFFu;
+#ifdef __SSE2__
+            // Unsigned bytes: x < t  <=>  min(x, t - 1) == x
+            __m128i x = _mm_loadu_si128((const __m128i*)px);
+            __m128i t = _mm_set1_epi8((char)(threshold - 1));
+            return (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(x, t), x));
+#else
+            unsigned m = 0;
+            for (int i = 0; i < 16; ++i) m |= (unsigned)(px[i] < threshold) << i;
+            return m;
+#endif
+        }
+
+        // The 32 subpixels of 16 pixels whose coins are the bits of m.
+        inline void putPairs16(unsigned m, int* out) {
+            memcpy(out, kTable.pairs[m & 0xFF], sizeof(kTable.pairs[0]));
+            memcpy(out + 16, kTable.pairs[m >> 8], sizeof(kTable.pairs[0]));
+        }
+
+        inline void putPairs16(unsigned m, unsigned char* out) {
+#ifdef __SSE2__
+            // Coin bits -> 0x00/0xFF byte masks (low byte to lanes 0-7, high
+            // byte to 8-15), then interleave !coin and coin as 0/1 bytes.
+            const __m128i bits = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, (char)128,
+                                               1, 2, 4, 8, 16, 32, 64, (char)128);
+            const __m128i one = _mm_set1_epi8(1);
+            __m128i v = _mm_unpacklo_epi64(_mm_set1_epi8((char)(m & 0xFF)), _mm_set1_epi8((char)(m >> 8)));
+            __m128i coin = _mm_cmpeq_epi8(_mm_and_si128(v, bits), bits);
+            __m128i first = _mm_andnot_si128(coin, one);
+            __m128i second = _mm_and_si128(coin, one);
+            _mm_storeu_si128((__m128i*)out, _mm_unpacklo_epi8(first, second));
+            _mm_storeu_si128((__m128i*)(out + 16), _mm_unpackhi_epi8(first, second));
+#else
+            memcpy(out, kTable8.pairs[m & 0xFF], sizeof(kTable8.pairs[0]));
+            memcpy(out + 16, kTable8.pairs[m >> 8], sizeof(kTable8.pairs[0]));
+#endif
+        }
+
+        std::vector<Scheduler::Task> submitGenerate(const Image& input, int threshold, bool invert,
+                                                    Image& share1, Image& share2,
+                                                    const std::vector<Scheduler::Task>& after) {
+            int w = input.width;
+            int h = input.height;
+
+            // Expansion factor: 2 (horizontal)
+            share1 = Image(w * 2, h);
+            share2 = Image(w * 2, h);
+
+            // rand() is not safe to share between tiles, so each tile gets its
+            // own generator keyed from rand() here (keeps srand() meaningful).
+            std::vector<unsigned> key = Scheduler::randKey();
+
+            return Scheduler::submitRows(h, [&input, &share1, &share2, key, w, threshold, invert](int r0, int r1) {
+                std::mt19937 rng = Scheduler::tileRng(key, r0 / Scheduler::kTileRows);
+                for (int r = r0; r < r1; ++r) {
+                    if (w == 0) continue;
+                    encodeRow(&input.pixels[r][0], w, threshold, invert, rng,
+                              &share1.pixels[r][0], &share2.pixels[r][0]);
+                }
+            }, after);
+        }
+    }
+
+    template <typename In, typename Out>
+    void encodeRow(const In* px, int w, int threshold, bool invert, std::mt19937& rng, Out* s1, Out* s2) {
+        // 16 pixels per step: one compare mask and 16 coins, then 32 subpixels
+        // per share from two table lookups (int) or one SSE2 unpack (bytes).
+        const Out (&pairs)[256][16] = pairsFor(s1);
+        const unsigned flip = invert ? 0xFFFFu : 0u;
+        int c = 0;
+        for (; c + 16 <= w; c += 16) {
+            unsigned black = lessMask16(px + c, threshold) ^ flip;
+            unsigned coins = (unsigned)rng() & 0xFFFFu;
+            unsigned other = coins ^ black;
+
+            putPairs16(coins, s1 + 2 * c);
+            putPairs16(other, s2 + 2 * c);
         }
+        // Tail (< 16 pixels)
+        for (; c < w; ++c) {
+            int black = ((px[c] < threshold) != invert) ? 1 : 0;
+            int coin = rng() & 1;
+            const Out* p1 = pairs[coin];
+            const Out* p2 = pairs[coin ^ black];
+            s1[2 * c] = p1[0]; s1[2 * c + 1] = p1[1];
+            s2[2 * c] = p2[0]; s2[2 * c + 1] = p2[1];
+        }
+    }
+
+    template void encodeRow<int, int>(const int*, int, int, bool, std::mt19937&, int*, int*);
+    template void encodeRow<unsigned char, unsigned char>(const unsigned char*, int, int, bool, std::mt19937&,
+                                                          unsigned char*, unsigned char*);
+
+    void generateShares(const Image& secret, Image& share1, Image& share2) {
+        // Binary secret: 0=White, anything else Black, i.e. black = !(pixel < 1).
+        Scheduler::waitAll(submitGenerate(secret, 1, true, share1, share2, std::vector<Scheduler::Task>()));
+    }
+
+    void generateSharesFromGray(const Image& input, int threshold, Image& share1, Image& share2) {
+        // Same rule as binarizeImage: pixel < threshold -> Black.
+        Scheduler::waitAll(submitGenerateFromGray(input, threshold, share1, share2));
     }
 
-    Image decryptShares(const Image& share1, const Image& share2) {
+    std::vector<Scheduler::Task> submitGenerateFromGray(const Image& input, int threshold, Image& share1, Image& share2,
+                                                        const std::vector<Scheduler::Task>& after) {
+        return submitGenerate(input, threshold, false, share1, share2, after);
+    }
+
+    Image decryptShares(const Image& share1, const Image& share2, Pyramid::Accumulator* pyramid) {
+        Image result(0, 0);
+        Scheduler::waitAll(submitDecrypt(share1, share2, result, pyramid));
+        return result;
+    }
+
+    std::vector<Scheduler::Task> submitDecrypt(const Image& share1, const Image& share2, Image& result,
+                                               Pyramid::Accumulator* pyramid,
+                                               const std::vector<Scheduler::Task>& after) {
         int w = share1.width; // 2W
         int h = share1.height;
-        Image result(w, h);
-
-        for (int r = 0; r < h; ++r) {
-            for (int c = 0; c < w; ++c) {
-                // Visual Cryptography relies on OR (stacking transparencies)
-                // 1=Black (Opaque), 0=White (Transparent)
-                // If either is 1, result is 1.
-                result.pixels[r][c] = share1.pixels[r][c] | share2.pixels[r][c];
+        result = Image(w, h);
+
+        return Scheduler::submitRows(h, [&share1, &share2, &result, pyramid, w](int r0, int r1) {
+            for (int r = r0; r < r1; ++r) {
+                for (int c = 0; c < w; ++c) {
+                    // Visual Cryptography relies on OR (stacking transparencies)
+                    // 1=Black (Opaque), 0=White (Transparent)
+                    // If either is 1, result is 1.
+                    result.pixels[r][c] = share1.pixels[r][c] | share2.pixels[r][c];
+                }
+                if (pyramid) pyramid->addRow(r, &result.pixels[r][0]);
             }
-        }
-        return result;
+        }, after);
     }
 
 }
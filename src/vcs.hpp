@@ -2,6 +2,9 @@
 #define VCS_HPP
 
 #include "image_utils.hpp"
+#include "pyramid.hpp"
+#include "scheduler.hpp"
+#include <random>
 
 namespace VCS {
     // Generate (2,2) shares using Naor-Shamir scheme.
@@ -9,10 +12,33 @@ namespace VCS {
     // Outputs: Share1, Share2 (Width will be 2 * Input.Width).
     void generateShares(const Image& secret, Image& share1, Image& share2);
 
+    // Same as generateShares(binarizeImage(input, threshold), ...) but
+    // thresholds and encodes in one pass, without the intermediate binary
+    // image. Uses lookup tables (8 pixels + 8 coins per lookup).
+    void generateSharesFromGray(const Image& input, int threshold, Image& share1, Image& share2);
+
     // Simulate visual decryption (OR operation).
     // Input: Share1, Share2.
     // Output: Reconstructed image.
-    Image decryptShares(const Image& share1, const Image& share2);
+    // pyramid (optional, xScale 2) collects the stack preview in the same pass.
+    Image decryptShares(const Image& share1, const Image& share2, Pyramid::Accumulator* pyramid = 0);
+
+    // Tile-task forms of the above for pipelining stages: outputs are sized
+    // right away, tile i only starts once after[i] finished (e.g. the same
+    // tile of the stage producing the input) and returned task i finishes
+    // with that tile. Every image passed must outlive the tasks.
+    std::vector<Scheduler::Task> submitGenerateFromGray(const Image& input, int threshold, Image& share1, Image& share2,
+                                                        const std::vector<Scheduler::Task>& after = std::vector<Scheduler::Task>());
+    std::vector<Scheduler::Task> submitDecrypt(const Image& share1, const Image& share2, Image& result,
+                                               Pyramid::Accumulator* pyramid = 0,
+                                               const std::vector<Scheduler::Task>& after = std::vector<Scheduler::Task>());
+
+    // Row kernel behind both generators, also used on raw 8-bit buffers by
+    // the C API (instantiated for int and unsigned char pixels).
+    // A pixel is black when (pixel < threshold) != invert; s1/s2 get 2*w
+    // subpixels (1 = Black, 0 = White).
+    template <typename In, typename Out>
+    void encodeRow(const In* px, int w, int threshold, bool invert, std::mt19937& rng, Out* s1, Out* s2);
 }
 
 #endif // VCS_HPP
@@ -0,0 +1,253 @@
+#include "vcsg.h"
+#include "audit.hpp"
+#include "dhcod.hpp"
+#include "image_utils.hpp"
+#include "resample.hpp"
+#include "rg.hpp"
+#include "scheduler.hpp"
+#include "vcs.hpp"
+#include <new>
+#include <random>
+#include <vector>
+
+// C API over the row kernels. Each tile runs the same encodeRow/halftoneRow
+// the Image code uses, but reads and writes the caller's rows in place
+// (data + r * stride); only per-tile row scratch is allocated.
+
+namespace {
+
+    unsigned char* rowOf(const vcsg_buffer* b, int r) {
+        return b->data + r * b->stride;
+    }
+
+    // Rows closer than width bytes would overlap, and tiles write rows concurrently.
+    bool valid(const vcsg_buffer* b) {
+        return b && b->data && b->width > 0 && b->height > 0 &&
+               (b->stride >= b->width || -b->stride >= b->width) &&
+               (b->format == VCSG_GRAY8 || b->format == VCSG_BINARY8);
+    }
+
+    bool sameSize(const vcsg_buffer* a, int w, int h) {
+        return a->width == w && a->height == h;
+    }
+
+    // Kernels produce 1 = Black, 0 = White; GRAY8 outputs want PGM values.
+    void finishRow(unsigned char* row, int w, vcsg_format format) {
+        if (format != VCSG_GRAY8) return;
+        for (int c = 0; c < w; ++c) row[c] = row[c] ? 0 : 255;
+    }
+
+    int blackBit(unsigned char v, vcsg_format format) {
+        return format == VCSG_GRAY8 ? (v < 128) : (v != 0);
+    }
+
+    // Key of the per-tile generators: opts->seed, or else fresh draws from
+    // std::random_device. Never rand(): nothing in an embedding process
+    // seeds it, so every process would produce the same shares.
+    std::vector<unsigned> tileKey(unsigned seed) {
+        if (seed) return std::vector<unsigned>(1, seed);
+        std::random_device rd;
+        std::vector<unsigned> key(4);
+        for (size_t i = 0; i < key.size(); ++i) key[i] = rd();
+        return key;
+    }
+
+    std::vector<const unsigned char*> rowPointers(const vcsg_buffer* b) {
+        std::vector<const unsigned char*> rows(b->height);
+        for (int r = 0; r < b->height; ++r) rows[r] = rowOf(b, r);
+        return rows;
+    }
+
+    int generate(vcsg_scheme scheme, const vcsg_buffer* secret, const vcsg_buffer* cover,
+                 const vcsg_options& opts, const vcsg_buffer* share1, const vcsg_buffer* share2) {
+        const int w = secret->width;
+        const int h = secret->height;
+        const int sw = (scheme == VCSG_SCHEME_VCS) ? 2 * w : w;
+        if (!sameSize(share1, sw, h) || !sameSize(share2, sw, h)) return VCSG_ERR_SIZE;
+
+        // A GRAY8 secret is thresholded, a BINARY8 one is black where non-zero.
+        const bool gray = secret->format == VCSG_GRAY8;
+        const int threshold = gray ? opts.threshold : 1;
+        const bool invert = !gray;
+
+        if (scheme == VCSG_SCHEME_VCS || scheme == VCSG_SCHEME_RG) {
+            std::vector<unsigned> key = tileKey(opts.seed);
+            Scheduler::parallelRows(h, [&](int r0, int r1) {
+                std::mt19937 rng = Scheduler::tileRng(key, r0 / Scheduler::kTileRows);
+                for (int r = r0; r < r1; ++r) {
+                    unsigned char* s1 = rowOf(share1, r);
+                    unsigned char* s2 = rowOf(share2, r);
+                    if (scheme == VCSG_SCHEME_VCS)
+                        VCS::encodeRow(rowOf(secret, r), w, threshold, invert, rng, s1, s2);
+                    else
+                        RG::encodeRow(rowOf(secret, r), w, threshold, invert, rng, s1, s2);
+                    finishRow(s1, sw, share1->format);
+                    finishRow(s2, sw, share2->format);
+                }
+            });
+            return VCSG_OK;
+        }
+
+        // DHCOD: the cover is fitted row by row straight from the caller's buffer.
+        if (!valid(cover)) return VCSG_ERR_ARGUMENT;
+        if (cover->format != VCSG_GRAY8) return VCSG_ERR_FORMAT;
+        Resample::RowSampler<unsigned char> coverRows(rowPointers(cover), cover->width, w, h,
+                                                      (Resample::Filter)opts.filter, (Resample::Fit)opts.fit);
+
+        Scheduler::parallelRows(h, [&](int r0, int r1) {
+            std::vector<int> coverRow(w), scratch;
+            for (int r = r0; r < r1; ++r) {
+                unsigned char* s1 = rowOf(share1, r);
+                unsigned char* s2 = rowOf(share2, r);
+                const unsigned char* in = rowOf(secret, r);
+                coverRows.row(r, &coverRow[0], scratch);
+                if (gray) {
+                    DHCOD::encodeRow(in, &coverRow[0], w, r, s1, s2);
+                } else {
+                    // Already binary: nothing to halftone on the secret side
+                    halftoneRow(&coverRow[0], w, r, s1);
+                    for (int c = 0; c < w; ++c) s2[c] = s1[c] ^ (in[c] != 0);
+                }
+                finishRow(s1, w, share1->format);
+                finishRow(s2, w, share2->format);
+            }
+        });
+        return VCSG_OK;
+    }
+}
+
+extern "C" {
+
+int vcsg_api_version(void) {
+    return VCSG_API_VERSION;
+}
+
+const char* vcsg_status_string(int status) {
+    switch (status) {
+        case VCSG_OK: return "ok";
+        case VCSG_ERR_ARGUMENT: return "invalid argument";
+        case VCSG_ERR_SIZE: return "buffer size mismatch";
+        case VCSG_ERR_FORMAT: return "unsupported pixel format";
+        case VCSG_ERR_MEMORY: return "out of memory";
+        case VCSG_ERR_INTERNAL: return "internal error";
+        default: return "unknown status";
+    }
+}
+
+void vcsg_set_threads(int n) {
+    try {
+        Scheduler::setThreadCount(n);
+    } catch (...) {
+        // Pool left unstarted; the next call retries with the default count
+    }
+}
+
+void vcsg_options_init(vcsg_options* opts) {
+    if (!opts) return;
+    opts->threshold = 128;
+    opts->seed = 0;
+    opts->filter = VCSG_RESAMPLE_BILINEAR;
+    opts->fit = VCSG_FIT_STRETCH;
+}
+
+int vcsg_share_size(vcsg_scheme scheme, int width, int height, int* share_width, int* share_height) {
+    if (!share_width || !share_height || width <= 0 || height <= 0) return VCSG_ERR_ARGUMENT;
+    if (scheme != VCSG_SCHEME_VCS && scheme != VCSG_SCHEME_RG && scheme != VCSG_SCHEME_DHCOD)
+        return VCSG_ERR_ARGUMENT;
+    *share_width = (scheme == VCSG_SCHEME_VCS) ? 2 * width : width;
+    *share_height = height;
+    return VCSG_OK;
+}
+
+int vcsg_generate(vcsg_scheme scheme, const vcsg_buffer* secret, const vcsg_buffer* cover,
+                  const vcsg_options* opts, const vcsg_buffer* share1, const vcsg_buffer* share2) {
+    if (!valid(secret) || !valid(share1) || !valid(share2)) return VCSG_ERR_ARGUMENT;
+    if (scheme != VCSG_SCHEME_VCS && scheme != VCSG_SCHEME_RG && scheme != VCSG_SCHEME_DHCOD)
+        return VCSG_ERR_ARGUMENT;
+
+    vcsg_options o;
+    vcsg_options_init(&o);
+    if (opts) o = *opts;
+    if (o.filter < VCSG_RESAMPLE_NEAREST || o.filter > VCSG_RESAMPLE_AREA ||
+        o.fit < VCSG_FIT_STRETCH || o.fit > VCSG_FIT_TILE)
+        return VCSG_ERR_ARGUMENT;
+
+    try {
+        return generate(scheme, secret, cover, o, share1, share2);
+    } catch (const std::bad_alloc&) {
+        return VCSG_ERR_MEMORY;
+    } catch (...) {
+        // Nothing may cross the C boundary: std::random_device, std::thread
+        // and task errors rethrown by waitAll all end up here
+        return VCSG_ERR_INTERNAL;
+    }
+}
+
+int vcsg_decrypt(vcsg_scheme scheme, const vcsg_buffer* share1, const vcsg_buffer* share2,
+                 const vcsg_buffer* out) {
+    if (!valid(share1) || !valid(share2) || !valid(out)) return VCSG_ERR_ARGUMENT;
+    if (scheme != VCSG_SCHEME_VCS && scheme != VCSG_SCHEME_RG && scheme != VCSG_SCHEME_DHCOD)
+        return VCSG_ERR_ARGUMENT;
+    const int w = share1->width;
+    const int h = share1->height;
+    if (!sameSize(share2, w, h) || !sameSize(out, w, h)) return VCSG_ERR_SIZE;
+
+    // Stacking transparencies = OR; DHCOD is reconstructed digitally with XOR.
+    const bool useXor = (scheme == VCSG_SCHEME_DHCOD);
+    try {
+        Scheduler::parallelRows(h, [&](int r0, int r1) {
+            for (int r = r0; r < r1; ++r) {
+                const unsigned char* a = rowOf(share1, r);
+                const unsigned char* b = rowOf(share2, r);
+                unsigned char* o = rowOf(out, r);
+                for (int c = 0; c < w; ++c) {
+                    int x = blackBit(a[c], share1->format);
+                    int y = blackBit(b[c], share2->format);
+                    o[c] = (unsigned char)(useXor ? (x ^ y) : (x | y));
+                }
+                finishRow(o, w, out->format);
+            }
+        });
+    } catch (const std::bad_alloc&) {
+        return VCSG_ERR_MEMORY;
+    } catch (...) {
+        return VCSG_ERR_INTERNAL;
+    }
+    return VCSG_OK;
+}
+
+int vcsg_analyze(vcsg_scheme scheme, const vcsg_buffer* share, const vcsg_buffer* secret,
+                 vcsg_audit* report) {
+    if (!valid(share) || !report || (secret && !valid(secret))) return VCSG_ERR_ARGUMENT;
+    if (scheme != VCSG_SCHEME_VCS && scheme != VCSG_SCHEME_RG && scheme != VCSG_SCHEME_DHCOD)
+        return VCSG_ERR_ARGUMENT;
+
+    Audit::Options opts;
+    opts.expansion = (scheme == VCSG_SCHEME_VCS) ? 2 : 1;
+    try {
+        std::vector<const unsigned char*> secretRows;
+        if (secret) secretRows = rowPointers(secret);
+        Audit::Report rep = Audit::run(rowPointers(share), share->width, share->format == VCSG_GRAY8,
+                                       secret ? &secretRows : 0, secret ? secret->width : 0,
+                                       secret && secret->format == VCSG_GRAY8, opts);
+        report->black_ratio = rep.blackRatio;
+        report->min_block_entropy = rep.minBlockEntropy;
+        report->mean_block_entropy = rep.meanBlockEntropy;
+        report->runs_z = rep.runsZ;
+        report->autocorr_h = rep.autocorrH;
+        report->autocorr_v = rep.autocorrV;
+        report->autocorr_d = rep.autocorrD;
+        report->chi_square = rep.chiSquare;
+        report->secret_corr = rep.secretCorr;
+        report->block_secret_z = rep.blockSecretZ;
+        report->failures = (int)rep.failures.size();
+        report->passed = rep.passed() ? 1 : 0;
+    } catch (const std::bad_alloc&) {
+        return VCSG_ERR_MEMORY;
+    } catch (...) {
+        return VCSG_ERR_INTERNAL;
+    }
+    return VCSG_OK;
+}
+
+}
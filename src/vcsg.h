@@ -0,0 +1,138 @@
+#ifndef VCSG_H
+#define VCSG_H
+
+/*
+ * libvcsg - C API of the visual cryptography engine.
+ *
+ * Every call works directly on caller-owned buffers described by a
+ * vcsg_buffer (pointer + stride + format); the library never copies an
+ * image, it only keeps a few rows of scratch per worker tile.
+ * Inputs and outputs must not overlap.
+ * Calls share one pool of worker threads and may run concurrently, except
+ * vcsg_set_threads (see below).
+ * Only the vcsg_* functions are exported from the shared library
+ * (SONAME libvcsg.so.1, following VCSG_API_VERSION).
+ */
+
+#include <stddef.h>
+
+#if defined(_WIN32)
+#define VCSG_API
+#else
+#define VCSG_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Bumped whenever a declaration below changes incompatibly. */
+#define VCSG_API_VERSION 1
+
+typedef enum {
+    VCSG_OK = 0,
+    VCSG_ERR_ARGUMENT = -1, /* null pointer, bad enum value, non-positive size */
+    VCSG_ERR_SIZE = -2,     /* buffer dimensions do not match what the call needs */
+    VCSG_ERR_FORMAT = -3,   /* pixel format not supported for this buffer */
+    VCSG_ERR_MEMORY = -4,   /* out of memory */
+    VCSG_ERR_INTERNAL = -5  /* any other failure (e.g. no worker thread or
+                               random device available) */
+} vcsg_status;
+
+typedef enum {
+    VCSG_GRAY8 = 0,  /* 1 byte per pixel, 0 = black .. 255 = white (PGM) */
+    VCSG_BINARY8 = 1 /* 1 byte per pixel, non-zero = black, 0 = white */
+} vcsg_format;
+
+typedef struct {
+    unsigned char* data; /* first pixel of the top row */
+    ptrdiff_t stride;    /* bytes from one row to the next (may be negative,
+                            |stride| >= width) */
+    int width;
+    int height;
+    vcsg_format format;
+} vcsg_buffer;
+
+typedef enum {
+    VCSG_SCHEME_VCS = 0,  /* Naor-Shamir (2,2), shares twice as wide, decrypt = OR */
+    VCSG_SCHEME_RG = 1,   /* Kafri-Keren random grids, decrypt = OR */
+    VCSG_SCHEME_DHCOD = 2 /* meaningful shares from a cover image, decrypt = XOR */
+} vcsg_scheme;
+
+typedef enum {
+    VCSG_RESAMPLE_NEAREST = 0,
+    VCSG_RESAMPLE_BILINEAR = 1,
+    VCSG_RESAMPLE_AREA = 2
+} vcsg_filter;
+
+typedef enum {
+    VCSG_FIT_STRETCH = 0,
+    VCSG_FIT_TILE = 1
+} vcsg_fit;
+
+typedef struct {
+    int threshold;      /* GRAY8 secret pixels below this are black (VCS, RG) */
+    unsigned int seed;  /* 0 = fresh seeds from std::random_device on every
+                           call; otherwise reproducible shares */
+    vcsg_filter filter; /* DHCOD cover fitting when its size differs */
+    vcsg_fit fit;
+} vcsg_options;
+
+typedef struct {
+    double black_ratio;
+    double min_block_entropy;
+    double mean_block_entropy;
+    double runs_z;
+    double autocorr_h;
+    double autocorr_v;
+    double autocorr_d;
+    double chi_square;
+    double secret_corr; /* 0 unless a secret was given */
+    double block_secret_z; /* worst 32x32 block's secret correlation, as r * sqrt(n) */
+    int failures;       /* number of failed checks */
+    int passed;         /* failures == 0 */
+} vcsg_audit;
+
+VCSG_API int vcsg_api_version(void);
+VCSG_API const char* vcsg_status_string(int status);
+
+/*
+ * Worker threads shared by all calls (default: VC_THREADS or the core count).
+ * Rebuilds the pool, so it must not run concurrently with any other vcsg
+ * call: call it once at startup, before the first one. If no thread can be
+ * started, the next call starts the default count instead (or fails with
+ * VCSG_ERR_INTERNAL).
+ */
+VCSG_API void vcsg_set_threads(int n);
+
+/* threshold 128, seed 0, bilinear stretch (what vc_program does). */
+VCSG_API void vcsg_options_init(vcsg_options* opts);
+
+/* Share size for a secret of width x height. */
+VCSG_API int vcsg_share_size(vcsg_scheme scheme, int width, int height, int* share_width, int* share_height);
+
+/*
+ * Encrypt secret into share1 and share2, which must already have the size
+ * given by vcsg_share_size; each may be GRAY8 or BINARY8.
+ * cover is required for DHCOD (GRAY8, any size) and ignored otherwise.
+ * opts may be NULL for the defaults.
+ */
+VCSG_API int vcsg_generate(vcsg_scheme scheme, const vcsg_buffer* secret, const vcsg_buffer* cover,
+                           const vcsg_options* opts, const vcsg_buffer* share1, const vcsg_buffer* share2);
+
+/* Stack share1 and share2 into out (all three the same size). */
+VCSG_API int vcsg_decrypt(vcsg_scheme scheme, const vcsg_buffer* share1, const vcsg_buffer* share2,
+                          const vcsg_buffer* out);
+
+/*
+ * Statistical security audit of one share (see Audit in analyze).
+ * secret may be NULL; otherwise it is the secret the share was made from.
+ */
+VCSG_API int vcsg_analyze(vcsg_scheme scheme, const vcsg_buffer* share, const vcsg_buffer* secret,
+                          vcsg_audit* report);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VCSG_H */